@@ -0,0 +1,258 @@
+#include "ColumnScan.h"
+
+#include "CpuFeatures.h"
+
+#include <immintrin.h>
+
+namespace CU
+{
+	namespace ColumnScan
+	{
+		namespace
+		{
+			//Set bits of every 4 bit value. POPCNT has its own CPUID bit and some SSE4.1 CPUs lack it, so masks are counted through this.
+			constexpr uint8_t NIBBLE_BITS[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+			//Lanes set in the movemask of a compare result, up to 8 lanes
+			size_t CountMaskLanes(int aMask)
+			{
+				return NIBBLE_BITS[aMask & 0xf] + NIBBLE_BITS[(aMask >> 4) & 0xf];
+			}
+
+			uint64_t SumScalar(const uint32_t* someValues, size_t aCount)
+			{
+				uint64_t sum = 0;
+				for (size_t i = 0; i < aCount; i++)
+				{
+					sum += someValues[i];
+				}
+				return sum;
+			}
+
+			uint64_t SumWhereEqualScalar(const uint32_t* someValues, const uint32_t* someKeys, size_t aCount, uint32_t aKey)
+			{
+				uint64_t sum = 0;
+				for (size_t i = 0; i < aCount; i++)
+				{
+					sum += someKeys[i] == aKey ? someValues[i] : 0;
+				}
+				return sum;
+			}
+
+			size_t CountWhereEqualScalar(const uint32_t* someKeys, size_t aCount, uint32_t aKey)
+			{
+				size_t count = 0;
+				for (size_t i = 0; i < aCount; i++)
+				{
+					count += someKeys[i] == aKey;
+				}
+				return count;
+			}
+
+			size_t CountAtLeastScalar(const uint32_t* someValues, size_t aCount, uint32_t aThreshold)
+			{
+				size_t count = 0;
+				for (size_t i = 0; i < aCount; i++)
+				{
+					count += someValues[i] >= aThreshold;
+				}
+				return count;
+			}
+
+			//Four 32-bit lanes zero extended into two 64-bit accumulators
+			__m128i AddWidenedSse41(__m128i aSum, __m128i someValues)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				return _mm_add_epi64(aSum, _mm_add_epi64(_mm_unpacklo_epi32(someValues, zero), _mm_unpackhi_epi32(someValues, zero)));
+			}
+
+			//Through memory, the 64-bit lane extracts only exist on x64
+			uint64_t HorizontalSumSse41(__m128i aSum)
+			{
+				alignas(16) uint64_t lanes[2];
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes), aSum);
+				return lanes[0] + lanes[1];
+			}
+
+			uint64_t SumSse41(const uint32_t* someValues, size_t aCount)
+			{
+				__m128i sum = _mm_setzero_si128();
+				size_t i = 0;
+				for (; i + 4 <= aCount; i += 4)
+				{
+					sum = AddWidenedSse41(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(someValues + i)));
+				}
+				return HorizontalSumSse41(sum) + SumScalar(someValues + i, aCount - i);
+			}
+
+			uint64_t SumWhereEqualSse41(const uint32_t* someValues, const uint32_t* someKeys, size_t aCount, uint32_t aKey)
+			{
+				const __m128i key = _mm_set1_epi32(static_cast<int>(aKey));
+				__m128i sum = _mm_setzero_si128();
+				size_t i = 0;
+				for (; i + 4 <= aCount; i += 4)
+				{
+					const __m128i matches = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(someKeys + i)), key);
+					sum = AddWidenedSse41(sum, _mm_and_si128(matches, _mm_loadu_si128(reinterpret_cast<const __m128i*>(someValues + i))));
+				}
+				return HorizontalSumSse41(sum) + SumWhereEqualScalar(someValues + i, someKeys + i, aCount - i, aKey);
+			}
+
+			//A match mask has one sign bit per lane, so its movemask counts the lanes
+			size_t CountWhereEqualSse41(const uint32_t* someKeys, size_t aCount, uint32_t aKey)
+			{
+				const __m128i key = _mm_set1_epi32(static_cast<int>(aKey));
+				size_t count = 0;
+				size_t i = 0;
+				for (; i + 4 <= aCount; i += 4)
+				{
+					const __m128i matches = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(someKeys + i)), key);
+					count += CountMaskLanes(_mm_movemask_ps(_mm_castsi128_ps(matches)));
+				}
+				return count + CountWhereEqualScalar(someKeys + i, aCount - i, aKey);
+			}
+
+			//There is no unsigned compare, but a value is at least the threshold exactly when it is the larger of the two
+			size_t CountAtLeastSse41(const uint32_t* someValues, size_t aCount, uint32_t aThreshold)
+			{
+				const __m128i threshold = _mm_set1_epi32(static_cast<int>(aThreshold));
+				size_t count = 0;
+				size_t i = 0;
+				for (; i + 4 <= aCount; i += 4)
+				{
+					const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(someValues + i));
+					const __m128i atLeast = _mm_cmpeq_epi32(_mm_max_epu32(values, threshold), values);
+					count += CountMaskLanes(_mm_movemask_ps(_mm_castsi128_ps(atLeast)));
+				}
+				return count + CountAtLeastScalar(someValues + i, aCount - i, aThreshold);
+			}
+
+			__m256i AddWidenedAvx2(__m256i aSum, __m256i someValues)
+			{
+				const __m256i zero = _mm256_setzero_si256();
+				return _mm256_add_epi64(aSum, _mm256_add_epi64(_mm256_unpacklo_epi32(someValues, zero), _mm256_unpackhi_epi32(someValues, zero)));
+			}
+
+			uint64_t HorizontalSumAvx2(__m256i aSum)
+			{
+				return HorizontalSumSse41(_mm_add_epi64(_mm256_castsi256_si128(aSum), _mm256_extracti128_si256(aSum, 1)));
+			}
+
+			uint64_t SumAvx2(const uint32_t* someValues, size_t aCount)
+			{
+				__m256i sum = _mm256_setzero_si256();
+				size_t i = 0;
+				for (; i + 8 <= aCount; i += 8)
+				{
+					sum = AddWidenedAvx2(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(someValues + i)));
+				}
+				return HorizontalSumAvx2(sum) + SumSse41(someValues + i, aCount - i);
+			}
+
+			uint64_t SumWhereEqualAvx2(const uint32_t* someValues, const uint32_t* someKeys, size_t aCount, uint32_t aKey)
+			{
+				const __m256i key = _mm256_set1_epi32(static_cast<int>(aKey));
+				__m256i sum = _mm256_setzero_si256();
+				size_t i = 0;
+				for (; i + 8 <= aCount; i += 8)
+				{
+					const __m256i matches = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(someKeys + i)), key);
+					sum = AddWidenedAvx2(sum, _mm256_and_si256(matches, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(someValues + i))));
+				}
+				return HorizontalSumAvx2(sum) + SumWhereEqualSse41(someValues + i, someKeys + i, aCount - i, aKey);
+			}
+
+			size_t CountWhereEqualAvx2(const uint32_t* someKeys, size_t aCount, uint32_t aKey)
+			{
+				const __m256i key = _mm256_set1_epi32(static_cast<int>(aKey));
+				size_t count = 0;
+				size_t i = 0;
+				for (; i + 8 <= aCount; i += 8)
+				{
+					const __m256i matches = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(someKeys + i)), key);
+					count += CountMaskLanes(_mm256_movemask_ps(_mm256_castsi256_ps(matches)));
+				}
+				return count + CountWhereEqualSse41(someKeys + i, aCount - i, aKey);
+			}
+
+			size_t CountAtLeastAvx2(const uint32_t* someValues, size_t aCount, uint32_t aThreshold)
+			{
+				const __m256i threshold = _mm256_set1_epi32(static_cast<int>(aThreshold));
+				size_t count = 0;
+				size_t i = 0;
+				for (; i + 8 <= aCount; i += 8)
+				{
+					const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(someValues + i));
+					const __m256i atLeast = _mm256_cmpeq_epi32(_mm256_max_epu32(values, threshold), values);
+					count += CountMaskLanes(_mm256_movemask_ps(_mm256_castsi256_ps(atLeast)));
+				}
+				return count + CountAtLeastSse41(someValues + i, aCount - i, aThreshold);
+			}
+
+			typedef uint64_t (*SumFunction)(const uint32_t*, size_t);
+			typedef uint64_t (*SumWhereEqualFunction)(const uint32_t*, const uint32_t*, size_t, uint32_t);
+			typedef size_t (*CountFunction)(const uint32_t*, size_t, uint32_t);
+
+			SumFunction SelectSum()
+			{
+				if (CpuFeatures::HasAvx2())
+				{
+					return SumAvx2;
+				}
+				return CpuFeatures::HasSse41() ? SumSse41 : SumScalar;
+			}
+
+			SumWhereEqualFunction SelectSumWhereEqual()
+			{
+				if (CpuFeatures::HasAvx2())
+				{
+					return SumWhereEqualAvx2;
+				}
+				return CpuFeatures::HasSse41() ? SumWhereEqualSse41 : SumWhereEqualScalar;
+			}
+
+			CountFunction SelectCountWhereEqual()
+			{
+				if (CpuFeatures::HasAvx2())
+				{
+					return CountWhereEqualAvx2;
+				}
+				return CpuFeatures::HasSse41() ? CountWhereEqualSse41 : CountWhereEqualScalar;
+			}
+
+			CountFunction SelectCountAtLeast()
+			{
+				if (CpuFeatures::HasAvx2())
+				{
+					return CountAtLeastAvx2;
+				}
+				return CpuFeatures::HasSse41() ? CountAtLeastSse41 : CountAtLeastScalar;
+			}
+
+			const SumFunction ourSum = SelectSum();
+			const SumWhereEqualFunction ourSumWhereEqual = SelectSumWhereEqual();
+			const CountFunction ourCountWhereEqual = SelectCountWhereEqual();
+			const CountFunction ourCountAtLeast = SelectCountAtLeast();
+		}
+
+		uint64_t Sum(const uint32_t* someValues, size_t aCount)
+		{
+			return ourSum(someValues, aCount);
+		}
+
+		uint64_t SumWhereEqual(const uint32_t* someValues, const uint32_t* someKeys, size_t aCount, uint32_t aKey)
+		{
+			return ourSumWhereEqual(someValues, someKeys, aCount, aKey);
+		}
+
+		size_t CountWhereEqual(const uint32_t* someKeys, size_t aCount, uint32_t aKey)
+		{
+			return ourCountWhereEqual(someKeys, aCount, aKey);
+		}
+
+		size_t CountAtLeast(const uint32_t* someValues, size_t aCount, uint32_t aThreshold)
+		{
+			return ourCountAtLeast(someValues, aCount, aThreshold);
+		}
+	}
+}
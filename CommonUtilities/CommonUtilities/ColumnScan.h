@@ -0,0 +1,19 @@
+#pragma once
+#include "DllApi.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace CU
+{
+	//Aggregates over columns of 32-bit values, e.g. one field of many records stored as its own array.
+	//AVX2 or SSE4.1 is picked once at startup like in Hex, sums are 64-bit so they don't overflow.
+	namespace ColumnScan
+	{
+		DLL_API uint64_t Sum(const uint32_t* someValues, size_t aCount);
+		//Sum of someValues[i] for every i where someKeys[i] == aKey
+		DLL_API uint64_t SumWhereEqual(const uint32_t* someValues, const uint32_t* someKeys, size_t aCount, uint32_t aKey);
+		DLL_API size_t CountWhereEqual(const uint32_t* someKeys, size_t aCount, uint32_t aKey);
+		DLL_API size_t CountAtLeast(const uint32_t* someValues, size_t aCount, uint32_t aThreshold);
+	}
+}
@@ -0,0 +1,89 @@
+#include "CpuFeatures.h"
+
+#include <intrin.h>
+
+namespace CU
+{
+	namespace CpuFeatures
+	{
+		namespace
+		{
+			struct Features
+			{
+				bool mySsse3{};
+				bool mySse41{};
+				bool myAvx2{};
+				bool myAvx512F{};
+				bool myShaNi{};
+			};
+
+			Features Probe()
+			{
+				Features features;
+				int info[4]{};
+				__cpuid(info, 0);
+				const int highestLeaf = info[0];
+				if (highestLeaf < 1)
+				{
+					return features;
+				}
+
+				__cpuid(info, 1);
+				features.mySsse3 = (info[2] & (1 << 9)) != 0;
+				features.mySse41 = (info[2] & (1 << 19)) != 0;
+				const bool osUsesXsave = (info[2] & (1 << 27)) != 0;
+				const bool hasAvx = (info[2] & (1 << 28)) != 0;
+
+				//The OS has to save the wider registers on context switch before we may touch them
+				bool osSavesYmm = false;
+				bool osSavesZmm = false;
+				if (osUsesXsave && hasAvx)
+				{
+					const unsigned long long xcr0 = _xgetbv(0);
+					osSavesYmm = (xcr0 & 0x6) == 0x6;
+					osSavesZmm = (xcr0 & 0xe6) == 0xe6;
+				}
+
+				if (highestLeaf >= 7)
+				{
+					__cpuidex(info, 7, 0);
+					features.myAvx2 = osSavesYmm && (info[1] & (1 << 5)) != 0;
+					features.myAvx512F = osSavesZmm && (info[1] & (1 << 16)) != 0;
+					features.myShaNi = features.mySse41 && (info[1] & (1 << 29)) != 0;
+				}
+				return features;
+			}
+
+			const Features& GetFeatures()
+			{
+				static const Features features = Probe();
+				return features;
+			}
+		}
+
+		bool HasSsse3()
+		{
+			return GetFeatures().mySsse3;
+		}
+
+		bool HasSse41()
+		{
+			return GetFeatures().mySse41;
+		}
+
+		bool HasAvx2()
+		{
+			return GetFeatures().myAvx2;
+		}
+
+		bool HasAvx512F()
+		{
+			return GetFeatures().myAvx512F;
+		}
+
+		bool HasShaNi()
+		{
+			return GetFeatures().myShaNi;
+		}
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "DllApi.h"
+
+namespace CU
+{
+	namespace CpuFeatures
+	{
+		//All queries are answered from a single CPUID probe done on first use
+		DLL_API bool HasSsse3();
+		DLL_API bool HasSse41();
+		DLL_API bool HasAvx2();
+		DLL_API bool HasAvx512F();
+		DLL_API bool HasShaNi();
+	}
+}
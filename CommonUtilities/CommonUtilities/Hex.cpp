@@ -0,0 +1,219 @@
+#include "Hex.h"
+
+#include "CpuFeatures.h"
+
+#include <immintrin.h>
+
+namespace CU
+{
+	namespace Hex
+	{
+		namespace
+		{
+			const char ourDigits[] = "0123456789abcdef";
+
+			//-1 for anything that isn't a hex digit
+			int DigitValue(char aCharacter)
+			{
+				if (aCharacter >= '0' && aCharacter <= '9')
+				{
+					return aCharacter - '0';
+				}
+				const char lower = aCharacter | 0x20;
+				if (lower >= 'a' && lower <= 'f')
+				{
+					return lower - 'a' + 10;
+				}
+				return -1;
+			}
+
+			void EncodeScalar(const unsigned char* someBytes, size_t aSize, char* aHexOut)
+			{
+				for (size_t i = 0; i < aSize; i++)
+				{
+					aHexOut[2 * i] = ourDigits[someBytes[i] >> 4];
+					aHexOut[2 * i + 1] = ourDigits[someBytes[i] & 0x0f];
+				}
+			}
+
+			bool DecodeScalar(const char* aHex, size_t aByteCount, unsigned char* someBytesOut)
+			{
+				for (size_t i = 0; i < aByteCount; i++)
+				{
+					const int high = DigitValue(aHex[2 * i]);
+					const int low = DigitValue(aHex[2 * i + 1]);
+					if (high < 0 || low < 0)
+					{
+						return false;
+					}
+					someBytesOut[i] = static_cast<unsigned char>((high << 4) | low);
+				}
+				return true;
+			}
+
+			//Nibbles to characters with a 16 entry shuffle table, then interleaved high/low
+			void EncodeSsse3(const unsigned char* someBytes, size_t aSize, char* aHexOut)
+			{
+				const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ourDigits));
+				const __m128i lowMask = _mm_set1_epi8(0x0f);
+				size_t i = 0;
+				for (; i + 16 <= aSize; i += 16)
+				{
+					const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(someBytes + i));
+					const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), lowMask));
+					const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, lowMask));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(aHexOut + 2 * i), _mm_unpacklo_epi8(high, low));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(aHexOut + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+				}
+				EncodeScalar(someBytes + i, aSize - i, aHexOut + 2 * i);
+			}
+
+			void EncodeAvx2(const unsigned char* someBytes, size_t aSize, char* aHexOut)
+			{
+				const __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ourDigits)));
+				const __m256i lowMask = _mm256_set1_epi8(0x0f);
+				size_t i = 0;
+				for (; i + 32 <= aSize; i += 32)
+				{
+					const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(someBytes + i));
+					const __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), lowMask));
+					const __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, lowMask));
+					//Unpacking works within 128-bit halves, so the halves are put back in order afterwards
+					const __m256i first = _mm256_unpacklo_epi8(high, low);
+					const __m256i second = _mm256_unpackhi_epi8(high, low);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(aHexOut + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(aHexOut + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+				}
+				EncodeSsse3(someBytes + i, aSize - i, aHexOut + 2 * i);
+			}
+
+			//Characters to nibble values, all lanes set in aValidOut when every character was a hex digit
+			__m128i DigitValuesSsse3(__m128i someCharacters, int& aValidOut)
+			{
+				const __m128i lower = _mm_or_si128(someCharacters, _mm_set1_epi8(0x20));
+				const __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(someCharacters, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(someCharacters, _mm_set1_epi8('9' + 1)));
+				const __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+				aValidOut = _mm_movemask_epi8(_mm_or_si128(isDigit, isLetter));
+				const __m128i digitValues = _mm_and_si128(isDigit, _mm_sub_epi8(someCharacters, _mm_set1_epi8('0')));
+				const __m128i letterValues = _mm_and_si128(isLetter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10)));
+				return _mm_or_si128(digitValues, letterValues);
+			}
+
+			bool DecodeSsse3(const char* aHex, size_t aByteCount, unsigned char* someBytesOut)
+			{
+				//Multiply-add of each pair of nibbles with 16 and 1 gives the byte in a 16-bit lane
+				const __m128i weights = _mm_set1_epi16(0x0110);
+				size_t i = 0;
+				for (; i + 16 <= aByteCount; i += 16)
+				{
+					int firstValid = 0;
+					int secondValid = 0;
+					const __m128i first = DigitValuesSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aHex + 2 * i)), firstValid);
+					const __m128i second = DigitValuesSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aHex + 2 * i + 16)), secondValid);
+					if ((firstValid & secondValid) != 0xffff)
+					{
+						return false;
+					}
+					const __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(first, weights), _mm_maddubs_epi16(second, weights));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(someBytesOut + i), bytes);
+				}
+				return DecodeScalar(aHex + 2 * i, aByteCount - i, someBytesOut + i);
+			}
+
+			__m256i DigitValuesAvx2(__m256i someCharacters, unsigned int& aValidOut)
+			{
+				const __m256i lower = _mm256_or_si256(someCharacters, _mm256_set1_epi8(0x20));
+				const __m256i isDigit = _mm256_and_si256(_mm256_cmpgt_epi8(someCharacters, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), someCharacters));
+				const __m256i isLetter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+				aValidOut = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_or_si256(isDigit, isLetter)));
+				const __m256i digitValues = _mm256_and_si256(isDigit, _mm256_sub_epi8(someCharacters, _mm256_set1_epi8('0')));
+				const __m256i letterValues = _mm256_and_si256(isLetter, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10)));
+				return _mm256_or_si256(digitValues, letterValues);
+			}
+
+			bool DecodeAvx2(const char* aHex, size_t aByteCount, unsigned char* someBytesOut)
+			{
+				const __m256i weights = _mm256_set1_epi16(0x0110);
+				size_t i = 0;
+				for (; i + 32 <= aByteCount; i += 32)
+				{
+					unsigned int firstValid = 0;
+					unsigned int secondValid = 0;
+					const __m256i first = DigitValuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(aHex + 2 * i)), firstValid);
+					const __m256i second = DigitValuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(aHex + 2 * i + 32)), secondValid);
+					if ((firstValid & secondValid) != 0xffffffff)
+					{
+						return false;
+					}
+					//Packing works within 128-bit halves, the quadwords are put back in order afterwards
+					const __m256i packed = _mm256_packus_epi16(_mm256_maddubs_epi16(first, weights), _mm256_maddubs_epi16(second, weights));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(someBytesOut + i), _mm256_permute4x64_epi64(packed, 0xd8));
+				}
+				return DecodeSsse3(aHex + 2 * i, aByteCount - i, someBytesOut + i);
+			}
+
+			typedef void (*EncodeFunction)(const unsigned char*, size_t, char*);
+			typedef bool (*DecodeFunction)(const char*, size_t, unsigned char*);
+
+			EncodeFunction SelectEncode()
+			{
+				if (CpuFeatures::HasAvx2())
+				{
+					return EncodeAvx2;
+				}
+				return CpuFeatures::HasSsse3() ? EncodeSsse3 : EncodeScalar;
+			}
+
+			DecodeFunction SelectDecode()
+			{
+				if (CpuFeatures::HasAvx2())
+				{
+					return DecodeAvx2;
+				}
+				return CpuFeatures::HasSsse3() ? DecodeSsse3 : DecodeScalar;
+			}
+
+			const EncodeFunction ourEncode = SelectEncode();
+			const DecodeFunction ourDecode = SelectDecode();
+		}
+
+		void Encode(const unsigned char* someBytes, size_t aSize, char* aHexOut)
+		{
+			ourEncode(someBytes, aSize, aHexOut);
+		}
+
+		std::string Encode(const unsigned char* someBytes, size_t aSize)
+		{
+			std::string hex(2 * aSize, '\0');
+			ourEncode(someBytes, aSize, &hex[0]);
+			return hex;
+		}
+
+		bool Decode(std::string_view aHex, unsigned char* someBytesOut)
+		{
+			if (aHex.size() % 2 != 0)
+			{
+				return false;
+			}
+			return ourDecode(aHex.data(), aHex.size() / 2, someBytesOut);
+		}
+
+		bool IsValid(std::string_view aHex)
+		{
+			if (aHex.size() % 2 != 0)
+			{
+				return false;
+			}
+			unsigned char scratch[256];
+			for (size_t offset = 0; offset < aHex.size(); offset += 2 * sizeof(scratch))
+			{
+				const size_t chunk = aHex.size() - offset < 2 * sizeof(scratch) ? aHex.size() - offset : 2 * sizeof(scratch);
+				if (!ourDecode(aHex.data() + offset, chunk / 2, scratch))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "DllApi.h"
+
+#include <string>
+#include <string_view>
+
+namespace CU
+{
+	namespace Hex
+	{
+		//Writes 2 * aSize lowercase hex characters to aHexOut, no terminator
+		DLL_API void Encode(const unsigned char* someBytes, size_t aSize, char* aHexOut);
+		DLL_API std::string Encode(const unsigned char* someBytes, size_t aSize);
+		//Writes aHex.size() / 2 bytes, upper and lower case digits are accepted.
+		//Returns false if aHex has an odd length or any non-hex character, someBytesOut is then left in an unspecified state.
+		DLL_API bool Decode(std::string_view aHex, unsigned char* someBytesOut);
+		DLL_API bool IsValid(std::string_view aHex);
+	}
+}
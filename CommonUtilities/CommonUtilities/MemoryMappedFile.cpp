@@ -0,0 +1,89 @@
+#include "MemoryMappedFile.h"
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#include <limits>
+
+namespace CU
+{
+	MemoryMappedFile::~MemoryMappedFile()
+	{
+		Close();
+	}
+
+	bool MemoryMappedFile::Open(const std::string& aPath)
+	{
+		Close();
+
+		HANDLE file = CreateFileA(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		myFile = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || static_cast<unsigned long long>(size.QuadPart) > std::numeric_limits<size_t>::max())
+		{
+			Close();
+			return false;
+		}
+		mySize = static_cast<size_t>(size.QuadPart);
+		if (mySize == 0)
+		{
+			//Empty files can't be mapped, but they are valid
+			return true;
+		}
+
+		myMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!myMapping)
+		{
+			Close();
+			return false;
+		}
+		myData = static_cast<const unsigned char*>(MapViewOfFile(myMapping, FILE_MAP_READ, 0, 0, 0));
+		if (!myData)
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void MemoryMappedFile::Close()
+	{
+		if (myData)
+		{
+			UnmapViewOfFile(myData);
+			myData = nullptr;
+		}
+		if (myMapping)
+		{
+			CloseHandle(myMapping);
+			myMapping = nullptr;
+		}
+		if (myFile)
+		{
+			CloseHandle(myFile);
+			myFile = nullptr;
+		}
+		mySize = 0;
+	}
+
+	bool MemoryMappedFile::IsOpen() const
+	{
+		return myFile != nullptr;
+	}
+
+	const unsigned char* MemoryMappedFile::GetData() const
+	{
+		return myData;
+	}
+
+	size_t MemoryMappedFile::GetSize() const
+	{
+		return mySize;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "DllApi.h"
+
+#include <cstdint>
+#include <string>
+
+namespace CU
+{
+	//Read-only mapping of a whole file. Other processes may keep reading and appending to the file while it is mapped.
+	class MemoryMappedFile
+	{
+	public:
+		MemoryMappedFile() = default;
+		DLL_API ~MemoryMappedFile();
+		MemoryMappedFile(const MemoryMappedFile& aMemoryMappedFile) = delete;
+		MemoryMappedFile& operator=(const MemoryMappedFile& aMemoryMappedFile) = delete;
+
+		//Returns false if the file doesn't exist or doesn't fit in the address space
+		DLL_API bool Open(const std::string& aPath);
+		DLL_API void Close();
+
+		DLL_API bool IsOpen() const;
+		//nullptr for an empty file
+		DLL_API const unsigned char* GetData() const;
+		DLL_API size_t GetSize() const;
+
+	private:
+		void* myFile{};
+		void* myMapping{};
+		const unsigned char* myData{};
+		size_t mySize{};
+	};
+}
@@ -0,0 +1,95 @@
+#include "SharedMemory.h"
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#include <cstdint>
+
+namespace CU
+{
+	SharedMemory::~SharedMemory()
+	{
+		Close();
+	}
+
+	bool SharedMemory::Create(const std::string& aName, size_t aSize)
+	{
+		Close();
+
+		const uint64_t size = aSize;
+		myMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), aName.c_str());
+		//A mapping left by someone else would not be zero filled
+		if (myMapping && GetLastError() == ERROR_ALREADY_EXISTS)
+		{
+			Close();
+			return false;
+		}
+		return Map(aSize);
+	}
+
+	bool SharedMemory::Open(const std::string& aName, size_t aSize)
+	{
+		Close();
+
+		myMapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, aName.c_str());
+		return Map(aSize);
+	}
+
+	bool SharedMemory::OpenOrCreate(const std::string& aName, size_t aSize, bool& anExistedOut)
+	{
+		Close();
+
+		const uint64_t size = aSize;
+		myMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), aName.c_str());
+		//The existing mapping keeps its own size, Map() fails if that is smaller than aSize
+		anExistedOut = myMapping && GetLastError() == ERROR_ALREADY_EXISTS;
+		return Map(aSize);
+	}
+
+	bool SharedMemory::Map(size_t aSize)
+	{
+		if (!myMapping)
+		{
+			return false;
+		}
+		myData = static_cast<unsigned char*>(MapViewOfFile(myMapping, FILE_MAP_ALL_ACCESS, 0, 0, aSize));
+		if (!myData)
+		{
+			Close();
+			return false;
+		}
+		mySize = aSize;
+		return true;
+	}
+
+	void SharedMemory::Close()
+	{
+		if (myData)
+		{
+			UnmapViewOfFile(myData);
+			myData = nullptr;
+		}
+		if (myMapping)
+		{
+			CloseHandle(myMapping);
+			myMapping = nullptr;
+		}
+		mySize = 0;
+	}
+
+	bool SharedMemory::IsOpen() const
+	{
+		return myData != nullptr;
+	}
+
+	unsigned char* SharedMemory::GetData() const
+	{
+		return myData;
+	}
+
+	size_t SharedMemory::GetSize() const
+	{
+		return mySize;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "DllApi.h"
+
+#include <cstddef>
+#include <string>
+
+namespace CU
+{
+	//Named read-write memory shared between processes, backed by the page file.
+	//The memory lives until every process that created or opened it has closed it.
+	class SharedMemory
+	{
+	public:
+		SharedMemory() = default;
+		DLL_API ~SharedMemory();
+		SharedMemory(const SharedMemory& aSharedMemory) = delete;
+		SharedMemory& operator=(const SharedMemory& aSharedMemory) = delete;
+
+		//New memory is zero filled. Returns false if aName is already in use or the memory can't be mapped.
+		DLL_API bool Create(const std::string& aName, size_t aSize);
+		//Maps memory another process created under aName, aSize has to be at most its size
+		DLL_API bool Open(const std::string& aName, size_t aSize);
+		//Create() that maps the memory instead of failing if a process still holds aName, e.g. one left by an earlier run.
+		//anExistedOut tells which happened, existing memory keeps its contents.
+		DLL_API bool OpenOrCreate(const std::string& aName, size_t aSize, bool& anExistedOut);
+		DLL_API void Close();
+
+		DLL_API bool IsOpen() const;
+		DLL_API unsigned char* GetData() const;
+		DLL_API size_t GetSize() const;
+
+	private:
+		bool Map(size_t aSize);
+
+		void* myMapping{};
+		unsigned char* myData{};
+		size_t mySize{};
+	};
+}
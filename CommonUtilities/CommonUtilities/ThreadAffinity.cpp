@@ -0,0 +1,27 @@
+#include "ThreadAffinity.h"
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+namespace CU
+{
+	namespace ThreadAffinity
+	{
+		unsigned int GetCoreCount()
+		{
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwNumberOfProcessors;
+		}
+
+		bool PinCurrentThread(unsigned int aCore)
+		{
+			if (aCore >= GetCoreCount() || aCore >= sizeof(DWORD_PTR) * 8)
+			{
+				return false;
+			}
+			return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << aCore) != 0;
+		}
+	}
+}
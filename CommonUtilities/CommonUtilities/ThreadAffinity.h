@@ -0,0 +1,13 @@
+#pragma once
+#include "DllApi.h"
+
+namespace CU
+{
+	namespace ThreadAffinity
+	{
+		//Logical processors in the current processor group
+		DLL_API unsigned int GetCoreCount();
+		//Keeps the calling thread on one logical processor, returns false if aCore doesn't exist
+		DLL_API bool PinCurrentThread(unsigned int aCore);
+	}
+}
@@ -1,91 +1,189 @@
 #include "sha256.h"
 
+#include "sha256_backends.h"
+#include "sha256_constexpr.h"
+#include "..\CpuFeatures.h"
+#include "..\Hex.h"
+#include "..\MemoryMappedFile.h"
+
+#include <atomic>
 #include <cstring>
 #include <fstream>
 
-#pragma warning( disable : 4996 )
-
 namespace CU {
-	const unsigned int SHA256::sha256_k[64] = //UL = uint32
-	{ 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-	 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-	 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-	 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-	 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-	 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-	 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-	 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-	 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-	 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-	 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-	 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-	 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-	 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-	 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-	 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
-
-	void SHA256::transform(const unsigned char* message, unsigned int block_nb)
-	{
-		uint32 w[64];
-		uint32 wv[8];
-		uint32 t1, t2;
-		const unsigned char* sub_block;
-		int i;
-		int j;
-		for (i = 0; i < (int)block_nb; i++) {
-			sub_block = message + (i << 6);
-			for (j = 0; j < 16; j++) {
-				SHA2_PACK32(&sub_block[j << 2], &w[j]);
+	namespace sha256_backends {
+		void transform_scalar(uint32* state, const unsigned char* message, size_t block_nb)
+		{
+			uint32 w[64];
+			uint32 wv[8];
+			uint32 t1, t2;
+			const unsigned char* sub_block;
+			size_t i;
+			int j;
+			for (i = 0; i < block_nb; i++) {
+				sub_block = message + (i << 6);
+				for (j = 0; j < 16; j++) {
+					SHA2_PACK32(&sub_block[j << 2], &w[j]);
+				}
+				for (j = 16; j < 64; j++) {
+					w[j] = SHA256_F4(w[j - 2]) + w[j - 7] + SHA256_F3(w[j - 15]) + w[j - 16];
+				}
+				for (j = 0; j < 8; j++) {
+					wv[j] = state[j];
+				}
+				for (j = 0; j < 64; j++) {
+					t1 = wv[7] + SHA256_F2(wv[4]) + SHA2_CH(wv[4], wv[5], wv[6])
+						+ k[j] + w[j];
+					t2 = SHA256_F1(wv[0]) + SHA2_MAJ(wv[0], wv[1], wv[2]);
+					wv[7] = wv[6];
+					wv[6] = wv[5];
+					wv[5] = wv[4];
+					wv[4] = wv[3] + t1;
+					wv[3] = wv[2];
+					wv[2] = wv[1];
+					wv[1] = wv[0];
+					wv[0] = t1 + t2;
+				}
+				for (j = 0; j < 8; j++) {
+					state[j] += wv[j];
+				}
+			}
+		}
+
+		transform_function get_transform(SHA256Backend backend)
+		{
+			switch (backend) {
+			case SHA256Backend::ShaNi:
+				return CpuFeatures::HasShaNi() ? transform_shani : nullptr;
+			case SHA256Backend::Sse4:
+				return CpuFeatures::HasSse41() && CpuFeatures::HasSsse3() ? transform_sse4 : nullptr;
+			default:
+				return transform_scalar;
+			}
+		}
+
+		size_t batch_single(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target)
+		{
+			for (size_t i = 0; i < count; i++) {
+				if (target) {
+					if (prefix.context->resumeMeetsTarget(messages[i], lengths[i], *target)) {
+						return i;
+					}
+				}
+				else {
+					prefix.context->resume(messages[i], lengths[i], digests + i * SHA256::DIGEST_SIZE);
+				}
+			}
+			return count;
+		}
+
+		batch_function get_batch(size_t lanes)
+		{
+			switch (lanes) {
+			case 16:
+				return CpuFeatures::HasAvx512F() ? batch_avx512 : nullptr;
+			case 8:
+				return CpuFeatures::HasAvx2() ? batch_avx2 : nullptr;
+			case 4:
+				return batch_sse2;
+			case 1:
+				return batch_single;
+			default:
+				return nullptr;
+			}
+		}
+	}
+
+	namespace {
+		constexpr bool matches(const SHA256Digest& digest, std::string_view expected_hex)
+		{
+			const auto hex = sha256ConstexprHex(digest);
+			if (expected_hex.size() != hex.size()) {
+				return false;
+			}
+			for (size_t i = 0; i < hex.size(); i++) {
+				if (hex[i] != expected_hex[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		//FIPS 180-2 vectors, covering one block, two padding blocks and a multi-block message
+		static_assert(matches(sha256Constexpr(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"), "constexpr SHA-256 is broken");
+		static_assert(matches(sha256Constexpr("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"), "constexpr SHA-256 is broken");
+		static_assert(matches(sha256Constexpr("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"), "constexpr SHA-256 is broken");
+		static_assert(matches(sha256Constexpr("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"), "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"), "constexpr SHA-256 is broken");
+
+		bool target_less(const uint32_t* left, const uint32_t* right)
+		{
+			for (int i = 0; i < 8; i++) {
+				if (left[i] != right[i]) {
+					return left[i] < right[i];
+				}
 			}
-			for (j = 16; j < 64; j++) {
-				w[j] = SHA256_F4(w[j - 2]) + w[j - 7] + SHA256_F3(w[j - 15]) + w[j - 16];
+			return false;
+		}
+
+		SHA256Backend select_backend()
+		{
+			if (sha256_backends::get_transform(SHA256Backend::ShaNi)) {
+				return SHA256Backend::ShaNi;
 			}
-			for (j = 0; j < 8; j++) {
-				wv[j] = m_h[j];
+			if (sha256_backends::get_transform(SHA256Backend::Sse4)) {
+				return SHA256Backend::Sse4;
 			}
-			for (j = 0; j < 64; j++) {
-				t1 = wv[7] + SHA256_F2(wv[4]) + SHA2_CH(wv[4], wv[5], wv[6])
-					+ sha256_k[j] + w[j];
-				t2 = SHA256_F1(wv[0]) + SHA2_MAJ(wv[0], wv[1], wv[2]);
-				wv[7] = wv[6];
-				wv[6] = wv[5];
-				wv[5] = wv[4];
-				wv[4] = wv[3] + t1;
-				wv[3] = wv[2];
-				wv[2] = wv[1];
-				wv[1] = wv[0];
-				wv[0] = t1 + t2;
+			return SHA256Backend::Scalar;
+		}
+
+		std::atomic<SHA256Backend> s_backend{ select_backend() };
+		std::atomic<sha256_backends::transform_function> s_transform{ sha256_backends::get_transform(s_backend.load()) };
+
+		size_t select_batch_lanes()
+		{
+			if (sha256_backends::get_batch(16)) {
+				return 16;
 			}
-			for (j = 0; j < 8; j++) {
-				m_h[j] += wv[j];
+			if (sha256_backends::get_batch(8)) {
+				return 8;
 			}
+			return 4;
 		}
+
+		std::atomic<size_t> s_batch_lanes{ select_batch_lanes() };
+		std::atomic<sha256_backends::batch_function> s_batch{ sha256_backends::get_batch(s_batch_lanes.load()) };
+
+	}
+
+	void SHA256::transform(const unsigned char* message, size_t block_nb)
+	{
+		s_transform.load(std::memory_order_relaxed)(m_h, message, block_nb);
+	}
+
+	SHA256::SHA256()
+	{
+		init();
 	}
 
 	void SHA256::init()
 	{
-		m_h[0] = 0x6a09e667;
-		m_h[1] = 0xbb67ae85;
-		m_h[2] = 0x3c6ef372;
-		m_h[3] = 0xa54ff53a;
-		m_h[4] = 0x510e527f;
-		m_h[5] = 0x9b05688c;
-		m_h[6] = 0x1f83d9ab;
-		m_h[7] = 0x5be0cd19;
+		for (int i = 0; i < 8; i++) {
+			m_h[i] = sha256_constexpr::initial_state[i];
+		}
 		m_len = 0;
 		m_tot_len = 0;
 	}
 
-	void SHA256::update(const unsigned char* message, unsigned int len)
+	void SHA256::update(const unsigned char* message, size_t len)
 	{
-		unsigned int block_nb;
-		unsigned int new_len, rem_len, tmp_len;
+		size_t block_nb;
+		size_t new_len, rem_len, tmp_len;
 		const unsigned char* shifted_message;
 		tmp_len = SHA224_256_BLOCK_SIZE - m_len;
 		rem_len = len < tmp_len ? len : tmp_len;
 		memcpy(&m_block[m_len], message, rem_len);
 		if (m_len + len < SHA224_256_BLOCK_SIZE) {
-			m_len += len;
+			m_len += static_cast<unsigned int>(len);
 			return;
 		}
 		new_len = len - rem_len;
@@ -95,43 +193,357 @@ namespace CU {
 		transform(shifted_message, block_nb);
 		rem_len = new_len % SHA224_256_BLOCK_SIZE;
 		memcpy(m_block, &shifted_message[block_nb << 6], rem_len);
-		m_len = rem_len;
-		m_tot_len += (block_nb + 1) << 6;
+		m_len = static_cast<unsigned int>(rem_len);
+		m_tot_len += (uint64)(block_nb + 1) << 6;
 	}
 
 	void SHA256::final(unsigned char* digest)
+	{
+		int i;
+		finish();
+		for (i = 0; i < 8; i++) {
+			SHA2_UNPACK32(m_h[i], &digest[i << 2]);
+		}
+	}
+
+	void SHA256::finish()
 	{
 		unsigned int block_nb;
 		unsigned int pm_len;
-		unsigned int len_b;
-		int i;
+		uint64 len_b;
 		block_nb = (1 + ((SHA224_256_BLOCK_SIZE - 9)
 			< (m_len % SHA224_256_BLOCK_SIZE)));
 		len_b = (m_tot_len + m_len) << 3;
 		pm_len = block_nb << 6;
 		memset(m_block + m_len, 0, pm_len - m_len);
 		m_block[m_len] = 0x80;
-		SHA2_UNPACK32(len_b, m_block + pm_len - 4);
+		SHA2_UNPACK32((uint32)(len_b >> 32), m_block + pm_len - 8);
+		SHA2_UNPACK32((uint32)len_b, m_block + pm_len - 4);
 		transform(m_block, block_nb);
-		for (i = 0; i < 8; i++) {
-			SHA2_UNPACK32(m_h[i], &digest[i << 2]);
-		}
 	}
 
-	std::string sha256(std::string input)
+	void SHA256::update(std::string_view message)
 	{
-		unsigned char digest[SHA256::DIGEST_SIZE];
-		memset(digest, 0, SHA256::DIGEST_SIZE);
+		update((const unsigned char*)message.data(), message.length());
+	}
 
-		SHA256 ctx = SHA256();
-		ctx.init();
-		ctx.update((unsigned char*)input.c_str(), static_cast<unsigned int>(input.length()));
+	void SHA256::resume(const unsigned char* suffix, size_t len, unsigned char* digest) const
+	{
+		SHA256 ctx = *this;
+		ctx.update(suffix, len);
 		ctx.final(digest);
+	}
+
+	SHA256Digest SHA256::resume(std::string_view suffix) const
+	{
+		SHA256Digest digest;
+		resume((const unsigned char*)suffix.data(), suffix.length(), digest.data());
+		return digest;
+	}
+
+	void SHA256::resumeBatch(const unsigned char* const* suffixes, const size_t* lengths, size_t count, unsigned char* digests) const
+	{
+		const sha256_backends::batch_prefix prefix{ this, m_h, m_block, m_len, m_tot_len };
+		s_batch.load(std::memory_order_relaxed)(prefix, suffixes, lengths, count, digests, nullptr);
+	}
+
+	bool SHA256::resumeMeetsTarget(const unsigned char* suffix, size_t len, const SHA256Target& target) const
+	{
+		SHA256 ctx = *this;
+		ctx.update(suffix, len);
+		ctx.finish();
+		return sha256_backends::meets_target(ctx.m_h, target);
+	}
+
+	size_t SHA256::resumeBatchFind(const unsigned char* const* suffixes, const size_t* lengths, size_t count, const SHA256Target& target) const
+	{
+		const sha256_backends::batch_prefix prefix{ this, m_h, m_block, m_len, m_tot_len };
+		return s_batch.load(std::memory_order_relaxed)(prefix, suffixes, lengths, count, nullptr, &target);
+	}
+
+	std::string sha256(std::string_view input)
+	{
+		return sha256ToHex(sha256Digest(input));
+	}
+
+	SHA256Digest sha256Digest(std::string_view anInput)
+	{
+		SHA256Digest digest;
+		sha256Digest((const unsigned char*)anInput.data(), anInput.length(), digest.data());
+		return digest;
+	}
+
+	void sha256Digest(const unsigned char* aMessage, size_t aLength, unsigned char* aDigestOut)
+	{
+		SHA256 ctx;
+		ctx.update(aMessage, aLength);
+		ctx.final(aDigestOut);
+	}
+
+	void sha256ToHex(const unsigned char* aDigest, char* aHexOut)
+	{
+		Hex::Encode(aDigest, SHA256::DIGEST_SIZE, aHexOut);
+	}
+
+	std::string sha256ToHex(const SHA256Digest& aDigest)
+	{
+		return Hex::Encode(aDigest.data(), aDigest.size());
+	}
+
+	bool sha256FromHex(std::string_view aHex, SHA256Digest& aDigestOut)
+	{
+		return aHex.size() == 2 * SHA256::DIGEST_SIZE && Hex::Decode(aHex, aDigestOut.data());
+	}
+
+	SHA256Target sha256TargetFromLeadingZeroBits(unsigned int aBits)
+	{
+		SHA256Target target;
+		for (unsigned int i = 0; i < 8; i++) {
+			const unsigned int zeroBits = aBits > 32 * i ? aBits - 32 * i : 0;
+			target.words[i] = zeroBits >= 32 ? 0 : 0xffffffffu >> zeroBits;
+		}
+		return target;
+	}
+
+	SHA256Target sha256TargetScale(const SHA256Target& aTarget, uint32_t aNumerator, uint32_t aDenominator)
+	{
+		//Schoolbook multiply and divide by one 32-bit word, the product gets a ninth word in front so nothing is lost in between
+		uint32_t product[9];
+		uint64_t carry = 0;
+		for (int i = 7; i >= 0; i--) {
+			const uint64_t word = uint64_t(aTarget.words[i]) * aNumerator + carry;
+			product[i + 1] = uint32_t(word);
+			carry = word >> 32;
+		}
+		product[0] = uint32_t(carry);
+
+		uint64_t remainder = 0;
+		for (int i = 0; i < 9; i++) {
+			const uint64_t dividend = (remainder << 32) | product[i];
+			product[i] = uint32_t(dividend / aDenominator);
+			remainder = dividend % aDenominator;
+		}
+		if (product[0] != 0) {
+			return sha256TargetFromLeadingZeroBits(0);
+		}
+		SHA256Target result;
+		for (int i = 0; i < 8; i++) {
+			result.words[i] = product[i + 1];
+		}
+		return result;
+	}
+
+	SHA256Target sha256TargetWork(const SHA256Target& aTarget)
+	{
+		//2^256 doesn't fit, but 2^256 / (aTarget + 1) == ~aTarget / (aTarget + 1) + 1 and both of those do
+		SHA256Target divisor = aTarget;
+		int carry = 7;
+		while (carry >= 0 && ++divisor.words[carry] == 0) {
+			carry--;
+		}
+		SHA256Target work = {};
+		if (carry < 0) {
+			//aTarget is all ones, every hash meets it
+			work.words[7] = 1;
+			return work;
+		}
+
+		//Schoolbook long division one bit at a time, the remainder can briefly need a 257th bit
+		uint32_t remainder[8] = {};
+		for (int bit = 255; bit >= 0; bit--) {
+			const bool overflow = (remainder[0] >> 31) != 0;
+			for (int i = 0; i < 7; i++) {
+				remainder[i] = (remainder[i] << 1) | (remainder[i + 1] >> 31);
+			}
+			remainder[7] = (remainder[7] << 1) | ((~aTarget.words[7 - bit / 32] >> (bit % 32)) & 1);
+			if (overflow || !target_less(remainder, divisor.words)) {
+				uint64_t borrow = 0;
+				for (int i = 7; i >= 0; i--) {
+					const uint64_t difference = uint64_t(remainder[i]) - divisor.words[i] - borrow;
+					remainder[i] = uint32_t(difference);
+					borrow = (difference >> 32) & 1;
+				}
+				work.words[7 - bit / 32] |= 1u << (bit % 32);
+			}
+		}
+		//Only a zero target would make the + 1 overflow, its work is infinite and saturates
+		const SHA256Target one = { { 0, 0, 0, 0, 0, 0, 0, 1 } };
+		return sha256TargetAdd(work, one);
+	}
+
+	SHA256Target sha256TargetAdd(const SHA256Target& aLeft, const SHA256Target& aRight)
+	{
+		SHA256Target sum;
+		uint64_t carry = 0;
+		for (int i = 7; i >= 0; i--) {
+			const uint64_t word = uint64_t(aLeft.words[i]) + aRight.words[i] + carry;
+			sum.words[i] = uint32_t(word);
+			carry = word >> 32;
+		}
+		return carry != 0 ? sha256TargetFromLeadingZeroBits(0) : sum;
+	}
 
-		char buf[2 * SHA256::DIGEST_SIZE + 1];
-		buf[2 * SHA256::DIGEST_SIZE] = 0;
-		for (int i = 0; i < SHA256::DIGEST_SIZE; i++)
-			sprintf(buf + i * 2, "%02x", digest[i]);
-		return std::string(buf);
+	uint32_t sha256TargetToCompact(const SHA256Target& aTarget)
+	{
+		unsigned char bytes[32];
+		for (int i = 0; i < 8; i++) {
+			for (int j = 0; j < 4; j++) {
+				bytes[(i << 2) + j] = static_cast<unsigned char>(aTarget.words[i] >> (24 - 8 * j));
+			}
+		}
+		int first = 0;
+		while (first < 32 && bytes[first] == 0) {
+			first++;
+		}
+		uint32_t mantissa = 0;
+		for (int i = first; i < first + 3; i++) {
+			mantissa = (mantissa << 8) | (i < 32 ? bytes[i] : 0);
+		}
+		return (uint32_t(32 - first) << 24) | mantissa;
+	}
+
+	SHA256Target sha256TargetFromCompact(uint32_t aCompact)
+	{
+		const uint32_t size = aCompact >> 24;
+		if (size > 32) {
+			return sha256TargetFromLeadingZeroBits(0);
+		}
+		unsigned char bytes[32] = {};
+		for (uint32_t i = 0; i < 3; i++) {
+			const uint32_t position = 32 - size + i;
+			if (position < 32) {
+				bytes[position] = static_cast<unsigned char>(aCompact >> (16 - 8 * i));
+			}
+		}
+		SHA256Target target;
+		for (int i = 0; i < 8; i++) {
+			const unsigned char* word = &bytes[i << 2];
+			target.words[i] = (uint32_t(word[0]) << 24) | (uint32_t(word[1]) << 16) | (uint32_t(word[2]) << 8) | uint32_t(word[3]);
+		}
+		return target;
+	}
+
+	bool sha256MeetsTarget(const unsigned char* aMessage, size_t aLength, const SHA256Target& aTarget)
+	{
+		return SHA256().resumeMeetsTarget(aMessage, aLength, aTarget);
+	}
+
+	bool sha256DigestMeetsTarget(const unsigned char* aDigest, const SHA256Target& aTarget)
+	{
+		uint32_t words[8];
+		for (int i = 0; i < 8; i++) {
+			const unsigned char* bytes = &aDigest[i << 2];
+			words[i] = (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+		}
+		return sha256_backends::meets_target(words, aTarget);
+	}
+
+	bool sha256File(const std::string& aPath, SHA256Digest& aDigestOut)
+	{
+		SHA256 ctx;
+		MemoryMappedFile file;
+		if (file.Open(aPath)) {
+			ctx.update(file.GetData(), file.GetSize());
+		}
+		else {
+			//Large sequential reads when the file can't be mapped, e.g. when it is bigger than a 32-bit address space
+			std::ifstream stream(aPath, std::ios::binary);
+			if (!stream) {
+				return false;
+			}
+			std::vector<unsigned char> buffer(1 << 20);
+			while (stream) {
+				stream.read((char*)buffer.data(), buffer.size());
+				ctx.update(buffer.data(), static_cast<size_t>(stream.gcount()));
+			}
+			if (stream.bad()) {
+				return false;
+			}
+		}
+		ctx.final(aDigestOut.data());
+		return true;
+	}
+
+	std::string sha256File(const std::string& aPath)
+	{
+		SHA256Digest digest;
+		if (!sha256File(aPath, digest)) {
+			return std::string();
+		}
+		return sha256ToHex(digest);
+	}
+
+	SHA256Backend sha256Backend()
+	{
+		return s_backend.load();
+	}
+
+	bool sha256BackendAvailable(SHA256Backend aBackend)
+	{
+		return sha256_backends::get_transform(aBackend) != nullptr;
+	}
+
+	bool sha256SetBackend(SHA256Backend aBackend)
+	{
+		sha256_backends::transform_function transform = sha256_backends::get_transform(aBackend);
+		if (!transform) {
+			return false;
+		}
+		s_transform.store(transform);
+		s_backend.store(aBackend);
+		return true;
+	}
+
+	const char* sha256BackendName(SHA256Backend aBackend)
+	{
+		switch (aBackend) {
+		case SHA256Backend::ShaNi:
+			return "sha-ni";
+		case SHA256Backend::Sse4:
+			return "sse4";
+		default:
+			return "scalar";
+		}
+	}
+
+	void sha256Batch(const unsigned char* const* someMessages, const size_t* someLengths, size_t aCount, unsigned char* someDigests)
+	{
+		SHA256().resumeBatch(someMessages, someLengths, aCount, someDigests);
+	}
+
+	std::vector<std::string> sha256Batch(const std::vector<std::string>& someInputs)
+	{
+		std::vector<const unsigned char*> messages(someInputs.size());
+		std::vector<size_t> lengths(someInputs.size());
+		for (size_t i = 0; i < someInputs.size(); i++) {
+			messages[i] = (const unsigned char*)someInputs[i].data();
+			lengths[i] = someInputs[i].length();
+		}
+		std::vector<unsigned char> digests(someInputs.size() * SHA256::DIGEST_SIZE);
+		sha256Batch(messages.data(), lengths.data(), someInputs.size(), digests.data());
+
+		std::vector<std::string> result;
+		result.reserve(someInputs.size());
+		for (size_t i = 0; i < someInputs.size(); i++) {
+			result.emplace_back(2 * SHA256::DIGEST_SIZE, '\0');
+			sha256ToHex(&digests[i * SHA256::DIGEST_SIZE], &result.back()[0]);
+		}
+		return result;
+	}
+
+	size_t sha256BatchLanes()
+	{
+		return s_batch_lanes.load();
+	}
+
+	bool sha256SetBatchLanes(size_t aLanes)
+	{
+		sha256_backends::batch_function batch = sha256_backends::get_batch(aLanes);
+		if (!batch) {
+			return false;
+		}
+		s_batch.store(batch);
+		s_batch_lanes.store(aLanes);
+		return true;
 	}
 }
\ No newline at end of file
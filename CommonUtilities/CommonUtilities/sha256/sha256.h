@@ -3,9 +3,24 @@
 
 #include "..\DllApi.h"
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace CU {
+	typedef std::array<uint8_t, 32> SHA256Digest;
+
+	//Proof-of-work threshold as eight 32-bit words, most significant first.
+	//A digest meets it when its value as a big-endian 256-bit number is at most the target.
+	struct SHA256Target
+	{
+		uint32_t words[8];
+	};
+
+	//Incremental hashing context. It is a plain value, so a copy taken after update() is a snapshot
+	//of the midstate that can be resumed any number of times, e.g. once per nonce after a shared prefix.
 	class SHA256
 	{
 	protected:
@@ -13,23 +28,87 @@ namespace CU {
 		typedef unsigned int uint32;
 		typedef unsigned long long uint64;
 
-		const static uint32 sha256_k[];
 		static const unsigned int SHA224_256_BLOCK_SIZE = (512 / 8);
 	public:
-		void init();
-		void update(const unsigned char* message, unsigned int len);
-		void final(unsigned char* digest);
+		DLL_API SHA256();
+		DLL_API void init();
+		DLL_API void update(const unsigned char* message, size_t len);
+		DLL_API void update(std::string_view message);
+		DLL_API void final(unsigned char* digest);
+		//Digest of everything absorbed so far followed by the suffix, leaves this context untouched
+		DLL_API void resume(const unsigned char* suffix, size_t len, unsigned char* digest) const;
+		DLL_API SHA256Digest resume(std::string_view suffix) const;
+		//As resume() for count suffixes at once through the multi-buffer path, digests receives count * DIGEST_SIZE bytes
+		DLL_API void resumeBatch(const unsigned char* const* suffixes, const size_t* lengths, size_t count, unsigned char* digests) const;
+		//Hash and target check in one step on the final state words, no digest bytes are produced
+		DLL_API bool resumeMeetsTarget(const unsigned char* suffix, size_t len, const SHA256Target& target) const;
+		//Index of the first suffix whose digest meets the target, count if none does. Stops after the first lane group with a hit.
+		DLL_API size_t resumeBatchFind(const unsigned char* const* suffixes, const size_t* lengths, size_t count, const SHA256Target& target) const;
 		static const unsigned int DIGEST_SIZE = (256 / 8);
 
 	protected:
-		void transform(const unsigned char* message, unsigned int block_nb);
-		unsigned int m_tot_len;
+		void transform(const unsigned char* message, size_t block_nb);
+		//Pads and compresses the last block(s), m_h then holds the digest as words
+		void finish();
+		uint64 m_tot_len;
 		unsigned int m_len;
 		unsigned char m_block[2 * SHA224_256_BLOCK_SIZE];
 		uint32 m_h[8];
 	};
 
-	DLL_API std::string sha256(std::string input);
+	enum class SHA256Backend
+	{
+		Scalar,
+		Sse4,
+		ShaNi
+	};
+
+	DLL_API std::string sha256(std::string_view input);
+
+	//Binary digests, nothing is allocated
+	DLL_API SHA256Digest sha256Digest(std::string_view anInput);
+	DLL_API void sha256Digest(const unsigned char* aMessage, size_t aLength, unsigned char* aDigestOut);
+	//Writes 2 * DIGEST_SIZE lowercase hex characters, no terminator
+	DLL_API void sha256ToHex(const unsigned char* aDigest, char* aHexOut);
+	DLL_API std::string sha256ToHex(const SHA256Digest& aDigest);
+	//Inverse of sha256ToHex(), false unless aHex is exactly 2 * DIGEST_SIZE hex characters. aDigestOut is then left unspecified.
+	DLL_API bool sha256FromHex(std::string_view aHex, SHA256Digest& aDigestOut);
+
+	//Target for "at least aBits leading zero bits"
+	DLL_API SHA256Target sha256TargetFromLeadingZeroBits(unsigned int aBits);
+	//aTarget * aNumerator / aDenominator rounded down, saturates at the all ones target instead of overflowing
+	DLL_API SHA256Target sha256TargetScale(const SHA256Target& aTarget, uint32_t aNumerator, uint32_t aDenominator);
+	//Hashes it takes on average to meet aTarget, 2^256 / (aTarget + 1) rounded down, as a 256-bit number laid out like a target.
+	//Chains are compared by the sum of it over their blocks rather than by their length.
+	DLL_API SHA256Target sha256TargetWork(const SHA256Target& aTarget);
+	//aLeft + aRight for work sums, saturates at all ones
+	DLL_API SHA256Target sha256TargetAdd(const SHA256Target& aLeft, const SHA256Target& aRight);
+	//Compact 32-bit form: the top byte is the number of significant bytes, the low three bytes are the leading ones of them.
+	//Anything below those three bytes is dropped, so a target survives the round trip only rounded down.
+	DLL_API uint32_t sha256TargetToCompact(const SHA256Target& aTarget);
+	DLL_API SHA256Target sha256TargetFromCompact(uint32_t aCompact);
+	DLL_API bool sha256MeetsTarget(const unsigned char* aMessage, size_t aLength, const SHA256Target& aTarget);
+	//For digests that were already computed, e.g. by sha256Batch
+	DLL_API bool sha256DigestMeetsTarget(const unsigned char* aDigest, const SHA256Target& aTarget);
+
+	//Streams a file through the hasher without reading it into memory first, returns false if it can't be read
+	DLL_API bool sha256File(const std::string& aPath, SHA256Digest& aDigestOut);
+	//Hex digest of a file, empty if it can't be read
+	DLL_API std::string sha256File(const std::string& aPath);
+
+	//Returns the compression backend chosen from CPUID at startup
+	DLL_API SHA256Backend sha256Backend();
+	DLL_API bool sha256BackendAvailable(SHA256Backend aBackend);
+	//Overrides the startup choice, returns false and keeps the current one if the CPU lacks aBackend
+	DLL_API bool sha256SetBackend(SHA256Backend aBackend);
+	DLL_API const char* sha256BackendName(SHA256Backend aBackend);
+
+	//Hashes aCount independent messages side by side in SIMD lanes, someDigests receives aCount * DIGEST_SIZE bytes
+	DLL_API void sha256Batch(const unsigned char* const* someMessages, const size_t* someLengths, size_t aCount, unsigned char* someDigests);
+	DLL_API std::vector<std::string> sha256Batch(const std::vector<std::string>& someInputs);
+	//Messages per batch pass (16 with AVX-512, 8 with AVX2, 4 with SSE2), 1 means one at a time through sha256Backend()
+	DLL_API size_t sha256BatchLanes();
+	DLL_API bool sha256SetBatchLanes(size_t aLanes);
 
 
 #define SHA2_SHFR(x, n)    (x >> n)
@@ -55,5 +134,5 @@ namespace CU {
            | ((uint32) *((str) + 1) << 16)    \
            | ((uint32) *((str) + 0) << 24);   \
 }
-#endif
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
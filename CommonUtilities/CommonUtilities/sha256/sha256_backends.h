@@ -0,0 +1,61 @@
+#ifndef SHA256_BACKENDS_H
+#define SHA256_BACKENDS_H
+
+#include "sha256.h"
+#include "sha256_constexpr.h"
+
+//Internal to CommonUtilities, the compression function implementations behind CU::SHA256
+namespace CU {
+	namespace sha256_backends {
+		typedef unsigned char uint8;
+		typedef unsigned int uint32;
+
+		typedef void (*transform_function)(uint32* state, const unsigned char* message, size_t block_nb);
+
+		using sha256_constexpr::k;
+
+		//Reference implementation, always available
+		void transform_scalar(uint32* state, const unsigned char* message, size_t block_nb);
+		//SSSE3 byte swap and SSE4.1 message schedule, scalar rounds
+		void transform_sse4(uint32* state, const unsigned char* message, size_t block_nb);
+		//Intel SHA extensions
+		void transform_shani(uint32* state, const unsigned char* message, size_t block_nb);
+
+		transform_function get_transform(SHA256Backend backend);
+
+		//Where every message of a batch continues from, see SHA256::resumeBatch
+		struct batch_prefix {
+			const SHA256* context;
+			const uint32* state;
+			const unsigned char* pending;
+			size_t pending_len;
+			unsigned long long absorbed_len;
+		};
+
+		//With a target, digests may be null and the index of the first message meeting the target is returned (count if none).
+		//Without one, every digest is written and count is returned.
+		typedef size_t (*batch_function)(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target);
+
+		//One message after the other through the active transform
+		size_t batch_single(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target);
+		//Multi-buffer, one message per 32-bit lane
+		size_t batch_sse2(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target);
+		size_t batch_avx2(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target);
+		size_t batch_avx512(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target);
+
+		batch_function get_batch(size_t lanes);
+
+		//Compares most significant word first and returns on the first word that differs, so a miss usually costs one compare
+		template <class Words>
+		inline bool meets_target(const Words& state, const SHA256Target& target)
+		{
+			for (int i = 0; i < 8; i++) {
+				if (state[i] != target.words[i]) {
+					return state[i] < target.words[i];
+				}
+			}
+			return true;
+		}
+	}
+}
+#endif
@@ -0,0 +1,140 @@
+#ifndef SHA256_CONSTEXPR_H
+#define SHA256_CONSTEXPR_H
+
+#include "sha256.h"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+//SHA-256 evaluated by the compiler, for digests that are known up front (genesis block, checkpoints, test vectors).
+//Same algorithm as CU::SHA256 written without intrinsics or memcpy, also the source of the round constants for the runtime backends.
+namespace CU {
+	namespace sha256_constexpr {
+		inline constexpr uint32_t k[64] =
+		{ 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+		 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+		 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+		 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+		 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+		 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+		 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+		 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+		 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+
+		inline constexpr uint32_t initial_state[8] =
+		{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+		constexpr uint32_t rotr(uint32_t x, int n)
+		{
+			return (x >> n) | (x << (32 - n));
+		}
+
+		//bytes is anything indexable with char or uint8_t elements
+		template <class Bytes>
+		constexpr void compress(uint32_t (&state)[8], const Bytes& bytes, size_t offset)
+		{
+			uint32_t w[64]{};
+			for (int j = 0; j < 16; j++) {
+				const size_t at = offset + (j << 2);
+				w[j] = (uint32_t(uint8_t(bytes[at])) << 24) | (uint32_t(uint8_t(bytes[at + 1])) << 16)
+					| (uint32_t(uint8_t(bytes[at + 2])) << 8) | uint32_t(uint8_t(bytes[at + 3]));
+			}
+			for (int j = 16; j < 64; j++) {
+				const uint32_t s0 = rotr(w[j - 15], 7) ^ rotr(w[j - 15], 18) ^ (w[j - 15] >> 3);
+				const uint32_t s1 = rotr(w[j - 2], 17) ^ rotr(w[j - 2], 19) ^ (w[j - 2] >> 10);
+				w[j] = w[j - 16] + s0 + w[j - 7] + s1;
+			}
+			uint32_t wv[8]{};
+			for (int j = 0; j < 8; j++) {
+				wv[j] = state[j];
+			}
+			for (int j = 0; j < 64; j++) {
+				const uint32_t t1 = wv[7] + (rotr(wv[4], 6) ^ rotr(wv[4], 11) ^ rotr(wv[4], 25))
+					+ ((wv[4] & wv[5]) ^ (~wv[4] & wv[6])) + k[j] + w[j];
+				const uint32_t t2 = (rotr(wv[0], 2) ^ rotr(wv[0], 13) ^ rotr(wv[0], 22))
+					+ ((wv[0] & wv[1]) ^ (wv[0] & wv[2]) ^ (wv[1] & wv[2]));
+				wv[7] = wv[6];
+				wv[6] = wv[5];
+				wv[5] = wv[4];
+				wv[4] = wv[3] + t1;
+				wv[3] = wv[2];
+				wv[2] = wv[1];
+				wv[1] = wv[0];
+				wv[0] = t1 + t2;
+			}
+			for (int j = 0; j < 8; j++) {
+				state[j] += wv[j];
+			}
+		}
+
+		template <class Bytes>
+		constexpr SHA256Digest digest(const Bytes& bytes, size_t length)
+		{
+			uint32_t state[8]{};
+			for (int j = 0; j < 8; j++) {
+				state[j] = initial_state[j];
+			}
+			size_t offset = 0;
+			for (; offset + 64 <= length; offset += 64) {
+				compress(state, bytes, offset);
+			}
+
+			uint8_t tail[128]{};
+			const size_t rem = length - offset;
+			for (size_t i = 0; i < rem; i++) {
+				tail[i] = uint8_t(bytes[offset + i]);
+			}
+			tail[rem] = 0x80;
+			const size_t tail_len = rem < 56 ? 64 : 128;
+			const uint64_t len_b = uint64_t(length) << 3;
+			for (int i = 0; i < 8; i++) {
+				tail[tail_len - 1 - i] = uint8_t(len_b >> (i << 3));
+			}
+			for (size_t t = 0; t < tail_len; t += 64) {
+				compress(state, tail, t);
+			}
+
+			SHA256Digest result{};
+			for (int j = 0; j < 8; j++) {
+				result[(j << 2)] = uint8_t(state[j] >> 24);
+				result[(j << 2) + 1] = uint8_t(state[j] >> 16);
+				result[(j << 2) + 2] = uint8_t(state[j] >> 8);
+				result[(j << 2) + 3] = uint8_t(state[j]);
+			}
+			return result;
+		}
+	}
+
+	constexpr SHA256Digest sha256Constexpr(std::string_view anInput)
+	{
+		return sha256_constexpr::digest(anInput, anInput.size());
+	}
+
+	template <size_t N>
+	constexpr SHA256Digest sha256Constexpr(const std::array<uint8_t, N>& someBytes)
+	{
+		return sha256_constexpr::digest(someBytes, N);
+	}
+
+	//Lowercase hex without terminator, compares directly against the strings returned by CU::sha256
+	constexpr std::array<char, 2 * SHA256::DIGEST_SIZE> sha256ConstexprHex(const SHA256Digest& aDigest)
+	{
+		constexpr char digits[] = "0123456789abcdef";
+		std::array<char, 2 * SHA256::DIGEST_SIZE> hex{};
+		for (size_t i = 0; i < aDigest.size(); i++) {
+			hex[2 * i] = digits[aDigest[i] >> 4];
+			hex[2 * i + 1] = digits[aDigest[i] & 0x0f];
+		}
+		return hex;
+	}
+}
+#endif
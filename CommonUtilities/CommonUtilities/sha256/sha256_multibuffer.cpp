@@ -0,0 +1,263 @@
+#include "sha256_backends.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace CU {
+	namespace sha256_backends {
+		namespace {
+			struct lanes_sse2 {
+				typedef __m128i vec;
+				static const unsigned int count = 4;
+				static vec load(const uint32* p) { return _mm_loadu_si128((const __m128i*)p); }
+				static void store(uint32* p, vec x) { _mm_storeu_si128((__m128i*)p, x); }
+				static vec set1(uint32 x) { return _mm_set1_epi32((int)x); }
+				static vec add(vec a, vec b) { return _mm_add_epi32(a, b); }
+				static vec xor_(vec a, vec b) { return _mm_xor_si128(a, b); }
+				static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+				static vec andnot(vec a, vec b) { return _mm_andnot_si128(a, b); }
+				static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+				template <int n> static vec shr(vec x) { return _mm_srli_epi32(x, n); }
+				template <int n> static vec rotr(vec x) { return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n)); }
+			};
+
+			struct lanes_avx2 {
+				typedef __m256i vec;
+				static const unsigned int count = 8;
+				static vec load(const uint32* p) { return _mm256_loadu_si256((const __m256i*)p); }
+				static void store(uint32* p, vec x) { _mm256_storeu_si256((__m256i*)p, x); }
+				static vec set1(uint32 x) { return _mm256_set1_epi32((int)x); }
+				static vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
+				static vec xor_(vec a, vec b) { return _mm256_xor_si256(a, b); }
+				static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+				static vec andnot(vec a, vec b) { return _mm256_andnot_si256(a, b); }
+				static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+				template <int n> static vec shr(vec x) { return _mm256_srli_epi32(x, n); }
+				template <int n> static vec rotr(vec x) { return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n)); }
+			};
+
+			struct lanes_avx512 {
+				typedef __m512i vec;
+				static const unsigned int count = 16;
+				static vec load(const uint32* p) { return _mm512_loadu_si512(p); }
+				static void store(uint32* p, vec x) { _mm512_storeu_si512(p, x); }
+				static vec set1(uint32 x) { return _mm512_set1_epi32((int)x); }
+				static vec add(vec a, vec b) { return _mm512_add_epi32(a, b); }
+				static vec xor_(vec a, vec b) { return _mm512_xor_si512(a, b); }
+				static vec and_(vec a, vec b) { return _mm512_and_si512(a, b); }
+				static vec andnot(vec a, vec b) { return _mm512_andnot_si512(a, b); }
+				static vec or_(vec a, vec b) { return _mm512_or_si512(a, b); }
+				template <int n> static vec shr(vec x) { return _mm512_srli_epi32(x, n); }
+				template <int n> static vec rotr(vec x) { return _mm512_ror_epi32(x, n); }
+			};
+
+			//A lane's view of prefix bytes still pending in the context followed by its own message.
+			//Only the first block can straddle the two, the last one or two blocks carry padding and bit length.
+			struct padded_tail {
+				unsigned char head[64];
+				unsigned char bytes[128];
+				const unsigned char* body;
+				size_t body_offset;
+				size_t body_blocks;
+				size_t total_blocks;
+
+				void init(const batch_prefix& prefix, const unsigned char* message, size_t len)
+				{
+					const size_t stream_len = prefix.pending_len + len;
+					body = message;
+					body_offset = prefix.pending_len;
+					body_blocks = stream_len >> 6;
+					const size_t rem = stream_len & 63;
+					const size_t tail_blocks = rem < 56 ? 1 : 2;
+					total_blocks = body_blocks + tail_blocks;
+
+					if (body_offset && body_blocks) {
+						memcpy(head, prefix.pending, body_offset);
+						memcpy(head + body_offset, message, 64 - body_offset);
+					}
+					memset(bytes, 0, sizeof(bytes));
+					if (!body_blocks) {
+						if (body_offset) {
+							memcpy(bytes, prefix.pending, body_offset);
+						}
+						if (len) {
+							memcpy(bytes + body_offset, message, len);
+						}
+					}
+					else if (rem) {
+						memcpy(bytes, message + (body_blocks << 6) - body_offset, rem);
+					}
+					bytes[rem] = 0x80;
+					const unsigned long long len_b = (prefix.absorbed_len + stream_len) << 3;
+					unsigned char* len_pos = bytes + (tail_blocks << 6) - 8;
+					for (int i = 0; i < 8; i++) {
+						len_pos[i] = (uint8)(len_b >> (56 - 8 * i));
+					}
+				}
+
+				const unsigned char* block(size_t index) const
+				{
+					if (index < body_blocks) {
+						return index == 0 && body_offset ? head : body + (index << 6) - body_offset;
+					}
+					index = std::min(index, total_blocks - 1);
+					return bytes + ((index - body_blocks) << 6);
+				}
+			};
+
+			template <class L>
+			void compress(typename L::vec* state, const typename L::vec* block)
+			{
+				typedef typename L::vec vec;
+				vec w[16];
+				vec wv[8];
+				for (int j = 0; j < 8; j++) {
+					wv[j] = state[j];
+				}
+				for (int j = 0; j < 64; j++) {
+					if (j < 16) {
+						w[j] = block[j];
+					}
+					else {
+						const vec w2 = w[(j - 2) & 15];
+						const vec w15 = w[(j - 15) & 15];
+						const vec s1 = L::xor_(L::xor_(L::template rotr<17>(w2), L::template rotr<19>(w2)), L::template shr<10>(w2));
+						const vec s0 = L::xor_(L::xor_(L::template rotr<7>(w15), L::template rotr<18>(w15)), L::template shr<3>(w15));
+						w[j & 15] = L::add(L::add(s1, w[(j - 7) & 15]), L::add(s0, w[j & 15]));
+					}
+					const vec e = wv[4];
+					const vec a = wv[0];
+					const vec f2 = L::xor_(L::xor_(L::template rotr<6>(e), L::template rotr<11>(e)), L::template rotr<25>(e));
+					const vec ch = L::xor_(L::and_(e, wv[5]), L::andnot(e, wv[6]));
+					const vec t1 = L::add(L::add(L::add(wv[7], f2), L::add(ch, L::set1(k[j]))), w[j & 15]);
+					const vec f1 = L::xor_(L::xor_(L::template rotr<2>(a), L::template rotr<13>(a)), L::template rotr<22>(a));
+					const vec maj = L::or_(L::and_(a, wv[1]), L::and_(wv[2], L::or_(a, wv[1])));
+					const vec t2 = L::add(f1, maj);
+					wv[7] = wv[6];
+					wv[6] = wv[5];
+					wv[5] = wv[4];
+					wv[4] = L::add(wv[3], t1);
+					wv[3] = wv[2];
+					wv[2] = wv[1];
+					wv[1] = wv[0];
+					wv[0] = L::add(t1, t2);
+				}
+				for (int j = 0; j < 8; j++) {
+					state[j] = L::add(state[j], wv[j]);
+				}
+			}
+
+			//Hashes up to L::count messages, one per lane, lanes whose message is shorter keep their state once done
+			template <class L>
+			size_t hash_lanes(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target)
+			{
+				typedef typename L::vec vec;
+				padded_tail tails[L::count];
+				size_t max_blocks = 0;
+				for (size_t l = 0; l < L::count; l++) {
+					if (l < count) {
+						tails[l].init(prefix, messages[l], lengths[l]);
+					}
+					else {
+						tails[l].init(prefix, nullptr, 0);
+					}
+					max_blocks = std::max(max_blocks, tails[l].total_blocks);
+				}
+
+				vec state[8];
+				for (int j = 0; j < 8; j++) {
+					state[j] = L::set1(prefix.state[j]);
+				}
+
+				uint32 words[16][L::count];
+				uint32 active[L::count];
+				vec block[16];
+				for (size_t b = 0; b < max_blocks; b++) {
+					for (size_t l = 0; l < L::count; l++) {
+						const unsigned char* sub_block = tails[l].block(b);
+						for (int j = 0; j < 16; j++) {
+							SHA2_PACK32(&sub_block[j << 2], &words[j][l]);
+						}
+						active[l] = b < tails[l].total_blocks ? 0xffffffff : 0;
+					}
+					for (int j = 0; j < 16; j++) {
+						block[j] = L::load(words[j]);
+					}
+
+					vec next[8];
+					for (int j = 0; j < 8; j++) {
+						next[j] = state[j];
+					}
+					compress<L>(next, block);
+					const vec mask = L::load(active);
+					for (int j = 0; j < 8; j++) {
+						state[j] = L::or_(L::and_(mask, next[j]), L::andnot(mask, state[j]));
+					}
+				}
+
+				uint32 out[8][L::count];
+				if (target) {
+					//Almost every candidate already fails on the first word, the others are only stored when a lane passes it
+					L::store(out[0], state[0]);
+					bool any_candidate = false;
+					for (size_t l = 0; l < count; l++) {
+						any_candidate |= out[0][l] <= target->words[0];
+					}
+					if (!any_candidate) {
+						return count;
+					}
+					for (int j = 1; j < 8; j++) {
+						L::store(out[j], state[j]);
+					}
+					for (size_t l = 0; l < count; l++) {
+						const uint32 words[8] = { out[0][l], out[1][l], out[2][l], out[3][l], out[4][l], out[5][l], out[6][l], out[7][l] };
+						if (meets_target(words, *target)) {
+							return l;
+						}
+					}
+					return count;
+				}
+
+				for (int j = 0; j < 8; j++) {
+					L::store(out[j], state[j]);
+				}
+				for (size_t l = 0; l < count; l++) {
+					for (int j = 0; j < 8; j++) {
+						SHA2_UNPACK32(out[j][l], &digests[(l << 5) + (j << 2)]);
+					}
+				}
+				return count;
+			}
+
+			template <class L>
+			size_t hash_batch(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target)
+			{
+				for (size_t i = 0; i < count; i += L::count) {
+					const size_t lanes = std::min<size_t>(L::count, count - i);
+					const size_t found = hash_lanes<L>(prefix, messages + i, lengths + i, lanes, target ? nullptr : digests + (i << 5), target);
+					if (found < lanes) {
+						return i + found;
+					}
+				}
+				return count;
+			}
+		}
+
+		size_t batch_sse2(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target)
+		{
+			return hash_batch<lanes_sse2>(prefix, messages, lengths, count, digests, target);
+		}
+
+		size_t batch_avx2(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target)
+		{
+			return hash_batch<lanes_avx2>(prefix, messages, lengths, count, digests, target);
+		}
+
+		size_t batch_avx512(const batch_prefix& prefix, const unsigned char* const* messages, const size_t* lengths, size_t count, unsigned char* digests, const SHA256Target* target)
+		{
+			return hash_batch<lanes_avx512>(prefix, messages, lengths, count, digests, target);
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#include "sha256_backends.h"
+
+#include <immintrin.h>
+
+namespace CU {
+	namespace sha256_backends {
+		void transform_shani(uint32* state, const unsigned char* message, size_t block_nb)
+		{
+			const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+			//The SHA instructions keep the state as ABEF/CDGH
+			__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1);
+			__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B);
+			__m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+			state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+			__m128i msg[4];
+			for (size_t i = 0; i < block_nb; i++) {
+				const unsigned char* sub_block = message + (i << 6);
+				const __m128i abef_save = state0;
+				const __m128i cdgh_save = state1;
+				for (int j = 0; j < 4; j++) {
+					msg[j] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(sub_block + (j << 4))), byte_swap);
+				}
+				//msg is a ring of the last sixteen schedule words, four per register
+				for (int j = 0; j < 16; j++) {
+					if (j >= 4) {
+						__m128i next = _mm_sha256msg1_epu32(msg[j & 3], msg[(j + 1) & 3]);
+						next = _mm_add_epi32(next, _mm_alignr_epi8(msg[(j + 3) & 3], msg[(j + 2) & 3], 4));
+						msg[j & 3] = _mm_sha256msg2_epu32(next, msg[(j + 3) & 3]);
+					}
+					__m128i wk = _mm_add_epi32(msg[j & 3], _mm_loadu_si128((const __m128i*)&k[j << 2]));
+					state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+					wk = _mm_shuffle_epi32(wk, 0x0E);
+					state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+				}
+				state0 = _mm_add_epi32(state0, abef_save);
+				state1 = _mm_add_epi32(state1, cdgh_save);
+			}
+
+			tmp = _mm_shuffle_epi32(state0, 0x1B);
+			state1 = _mm_shuffle_epi32(state1, 0xB1);
+			state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+			state1 = _mm_alignr_epi8(state1, tmp, 8);
+			_mm_storeu_si128((__m128i*)&state[0], state0);
+			_mm_storeu_si128((__m128i*)&state[4], state1);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#include "sha256_backends.h"
+
+#include <immintrin.h>
+
+namespace CU {
+	namespace sha256_backends {
+		namespace {
+			inline __m128i rotr(__m128i x, int n)
+			{
+				return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n));
+			}
+
+			inline __m128i sigma0(__m128i x)
+			{
+				return _mm_xor_si128(_mm_xor_si128(rotr(x, 7), rotr(x, 18)), _mm_srli_epi32(x, 3));
+			}
+
+			inline __m128i sigma1(__m128i x)
+			{
+				return _mm_xor_si128(_mm_xor_si128(rotr(x, 17), rotr(x, 19)), _mm_srli_epi32(x, 10));
+			}
+		}
+
+		void transform_sse4(uint32* state, const unsigned char* message, size_t block_nb)
+		{
+			const __m128i byte_swap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+			__m128i w[16];
+			alignas(16) uint32 wk[64];
+			uint32 wv[8];
+			uint32 t1, t2;
+			for (size_t i = 0; i < block_nb; i++) {
+				const unsigned char* sub_block = message + (i << 6);
+				for (int j = 0; j < 4; j++) {
+					w[j] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(sub_block + (j << 4))), byte_swap);
+				}
+				//Four schedule words per step, the sigma1 term depends on words of the same step so it is added in two halves
+				for (int j = 4; j < 16; j++) {
+					const __m128i w16 = w[j - 4];
+					const __m128i w12 = w[j - 3];
+					const __m128i w8 = w[j - 2];
+					const __m128i w4 = w[j - 1];
+					__m128i partial = _mm_add_epi32(w16, sigma0(_mm_alignr_epi8(w12, w16, 4)));
+					partial = _mm_add_epi32(partial, _mm_alignr_epi8(w4, w8, 4));
+					const __m128i low = _mm_add_epi32(partial, sigma1(_mm_shuffle_epi32(w4, _MM_SHUFFLE(3, 2, 3, 2))));
+					const __m128i high = _mm_add_epi32(partial, sigma1(_mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 1, 0))));
+					w[j] = _mm_blend_epi16(low, high, 0xF0);
+				}
+				for (int j = 0; j < 16; j++) {
+					_mm_store_si128((__m128i*)&wk[j << 2], _mm_add_epi32(w[j], _mm_loadu_si128((const __m128i*)&k[j << 2])));
+				}
+				for (int j = 0; j < 8; j++) {
+					wv[j] = state[j];
+				}
+				for (int j = 0; j < 64; j++) {
+					t1 = wv[7] + SHA256_F2(wv[4]) + SHA2_CH(wv[4], wv[5], wv[6]) + wk[j];
+					t2 = SHA256_F1(wv[0]) + SHA2_MAJ(wv[0], wv[1], wv[2]);
+					wv[7] = wv[6];
+					wv[6] = wv[5];
+					wv[5] = wv[4];
+					wv[4] = wv[3] + t1;
+					wv[3] = wv[2];
+					wv[2] = wv[1];
+					wv[1] = wv[0];
+					wv[0] = t1 + t2;
+				}
+				for (int j = 0; j < 8; j++) {
+					state[j] += wv[j];
+				}
+			}
+		}
+	}
+}
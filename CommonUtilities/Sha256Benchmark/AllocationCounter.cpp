@@ -0,0 +1,61 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> ourAllocations{ 0 };
+
+	void* Allocate(size_t aSize)
+	{
+		ourAllocations.fetch_add(1, std::memory_order_relaxed);
+		if (void* memory = std::malloc(aSize != 0 ? aSize : 1))
+		{
+			return memory;
+		}
+		throw std::bad_alloc();
+	}
+}
+
+namespace Sha256Benchmark
+{
+	namespace AllocationCounter
+	{
+		uint64_t GetCount()
+		{
+			return ourAllocations.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+void* operator new(size_t aSize)
+{
+	return Allocate(aSize);
+}
+
+void* operator new[](size_t aSize)
+{
+	return Allocate(aSize);
+}
+
+void operator delete(void* aMemory) noexcept
+{
+	std::free(aMemory);
+}
+
+void operator delete[](void* aMemory) noexcept
+{
+	std::free(aMemory);
+}
+
+void operator delete(void* aMemory, size_t) noexcept
+{
+	std::free(aMemory);
+}
+
+void operator delete[](void* aMemory, size_t) noexcept
+{
+	std::free(aMemory);
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+
+namespace Sha256Benchmark
+{
+	//Counts calls to the global operator new, which this executable replaces.
+	//Allocations made inside CommonUtilities.dll go through the DLL's own operator new and are not seen.
+	namespace AllocationCounter
+	{
+		uint64_t GetCount();
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+namespace Sha256Benchmark
+{
+	//Non-negative counter kept as decimal ASCII, Increment() updates the digits in place
+	//so a nonce loop never formats a number or touches the heap. Only the pow_nonce measurements of
+	//the old decimal-string proof of work use it, mining hashes binary header nonces now.
+	class DecimalNonce
+	{
+	public:
+		//Digits of the largest int64_t, one more fits for the carry out of an all-nines value
+		static constexpr size_t MAX_DIGITS = 19;
+
+		DecimalNonce(int64_t aValue = 0)
+		{
+			Set(aValue);
+		}
+
+		void Set(int64_t aValue)
+		{
+			myValue = aValue;
+			myLength = static_cast<size_t>(std::to_chars(myDigits, myDigits + sizeof(myDigits), aValue).ptr - myDigits);
+		}
+
+		void Increment()
+		{
+			myValue++;
+			for (size_t i = myLength; i-- > 0;)
+			{
+				if (myDigits[i] != '9')
+				{
+					myDigits[i]++;
+					return;
+				}
+				myDigits[i] = '0';
+			}
+			std::memmove(myDigits + 1, myDigits, myLength);
+			myDigits[0] = '1';
+			myLength++;
+		}
+
+		//Not null terminated
+		const char* GetData() const
+		{
+			return myDigits;
+		}
+
+		size_t GetLength() const
+		{
+			return myLength;
+		}
+
+		int64_t GetValue() const
+		{
+			return myValue;
+		}
+
+	private:
+		char myDigits[MAX_DIGITS + 1];
+		size_t myLength{};
+		int64_t myValue{};
+	};
+}
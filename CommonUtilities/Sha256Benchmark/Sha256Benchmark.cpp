@@ -0,0 +1,279 @@
+#include "Sha256Benchmark.h"
+
+#include "AllocationCounter.h"
+#include "DecimalNonce.h"
+
+#include <CommonUtilities/CpuFeatures.h>
+#include <CommonUtilities/sha256/sha256.h>
+#include <CommonUtilities/StopWatch.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <string_view>
+
+namespace Sha256Benchmark
+{
+	namespace
+	{
+		//From proof-of-work guesses up to file and snapshot sized inputs
+		const size_t MESSAGE_SIZES[] = { 8, 16, 32, 64, 128, 256, 1024, 4096, 16 << 10, 64 << 10, 1 << 20, 8 << 20 };
+		//Batches are for many small messages, larger ones go through the single message path
+		constexpr size_t MAX_BATCH_MESSAGE_SIZE = 4096;
+		constexpr size_t BATCH_SIZE = 64;
+		//Keeps the compiler from dropping hashes whose results are never read
+		volatile unsigned char ourSink;
+
+		const CU::SHA256Backend ourBackends[] = { CU::SHA256Backend::Scalar, CU::SHA256Backend::Sse4, CU::SHA256Backend::ShaNi };
+		const size_t ourLaneCounts[] = { 1, 4, 8, 16 };
+
+		//Proof-of-work attempts hash the last proof followed by the nonce, both in decimal
+		constexpr int64_t LAST_PROOF = 35293;
+		constexpr int64_t FIRST_NONCE = 1000000;
+		//Same check as a difficulty of 3 leading zero hex digits
+		constexpr unsigned int POW_ZERO_BITS = 12;
+		constexpr size_t MAX_BATCH_LANES = 16;
+	}
+
+	Suite::Suite(const Settings& someSettings)
+		: mySettings(someSettings)
+	{
+		for (size_t size : MESSAGE_SIZES)
+		{
+			if (size <= mySettings.maxMessageSize)
+			{
+				myMessageSizes.push_back(size);
+			}
+		}
+		//Room for BATCH_SIZE distinct messages of the largest batched size
+		myData.resize(std::max(myMessageSizes.back(), MAX_BATCH_MESSAGE_SIZE + BATCH_SIZE));
+		for (size_t i = 0; i < myData.size(); i++)
+		{
+			myData[i] = static_cast<unsigned char>('0' + (i * 7) % 10);
+		}
+	}
+
+	void Suite::Run()
+	{
+		const CU::SHA256Backend startupBackend = CU::sha256Backend();
+		const size_t startupLanes = CU::sha256BatchLanes();
+
+		for (CU::SHA256Backend backend : ourBackends)
+		{
+			if (CU::sha256SetBackend(backend))
+			{
+				RunSingle(CU::sha256BackendName(backend));
+			}
+		}
+		CU::sha256SetBackend(startupBackend);
+
+		for (size_t lanes : ourLaneCounts)
+		{
+			if (CU::sha256SetBatchLanes(lanes))
+			{
+				RunBatch(lanes);
+			}
+		}
+		CU::sha256SetBatchLanes(startupLanes);
+
+		RunProofOfWork();
+	}
+
+	void Suite::RunSingle(const std::string& aBackend)
+	{
+		const CU::SHA256Target target = CU::sha256TargetFromLeadingZeroBits(12);
+		for (size_t size : myMessageSizes)
+		{
+			const unsigned char* message = myData.data();
+			const std::string_view text(reinterpret_cast<const char*>(message), size);
+
+			Measure("string", aBackend, 1, size, size, [&]()
+				{
+					ourSink = CU::sha256(text)[0];
+				});
+			Measure("digest", aBackend, 1, size, size, [&]()
+				{
+					unsigned char digest[CU::SHA256::DIGEST_SIZE];
+					CU::sha256Digest(message, size, digest);
+					ourSink = digest[0];
+				});
+			Measure("target", aBackend, 1, size, size, [&]()
+				{
+					ourSink = CU::sha256MeetsTarget(message, size, target);
+				});
+		}
+	}
+
+	void Suite::RunBatch(size_t aLanes)
+	{
+		const std::string backend = CU::sha256BackendName(CU::sha256Backend());
+		std::vector<const unsigned char*> messages(BATCH_SIZE);
+		std::vector<size_t> lengths(BATCH_SIZE);
+		std::vector<std::string> strings(BATCH_SIZE);
+		std::vector<unsigned char> digests(BATCH_SIZE * CU::SHA256::DIGEST_SIZE);
+		//Never met, so resumeBatchFind has to look at every message
+		CU::SHA256Target target{};
+		const CU::SHA256 emptyPrefix;
+
+		for (size_t size : myMessageSizes)
+		{
+			if (size > MAX_BATCH_MESSAGE_SIZE)
+			{
+				break;
+			}
+			for (size_t i = 0; i < BATCH_SIZE; i++)
+			{
+				messages[i] = myData.data() + i;
+				lengths[i] = size;
+				strings[i].assign(reinterpret_cast<const char*>(messages[i]), size);
+			}
+
+			//Batch results are per message so they line up with the single message rows
+			Measure("batch_string", backend, aLanes, size, size * BATCH_SIZE, [&]()
+				{
+					ourSink = CU::sha256Batch(strings).back()[0];
+				});
+			Measure("batch_digest", backend, aLanes, size, size * BATCH_SIZE, [&]()
+				{
+					CU::sha256Batch(messages.data(), lengths.data(), BATCH_SIZE, digests.data());
+					ourSink = digests.back();
+				});
+			Measure("batch_target", backend, aLanes, size, size * BATCH_SIZE, [&]()
+				{
+					ourSink = static_cast<unsigned char>(emptyPrefix.resumeBatchFind(messages.data(), lengths.data(), BATCH_SIZE, target));
+				});
+		}
+	}
+
+	void Suite::RunProofOfWork()
+	{
+		const std::string backend = CU::sha256BackendName(CU::sha256Backend());
+		const std::string lastProof = std::to_string(LAST_PROOF);
+		const size_t guessLength = lastProof.length() + std::to_string(FIRST_NONCE).length();
+		const CU::SHA256Target target = CU::sha256TargetFromLeadingZeroBits(POW_ZERO_BITS);
+		CU::SHA256 lastProofContext;
+		lastProofContext.update(lastProof);
+
+		//What every attempt used to do: format both numbers, concatenate, hash to hex and compare a prefix
+		int64_t stringNonce = FIRST_NONCE;
+		Measure("pow_strings", backend, 1, guessLength, guessLength, [&]()
+			{
+				const std::string guess = std::to_string(LAST_PROOF) + std::to_string(stringNonce++);
+				ourSink = CU::sha256(guess).substr(0, POW_ZERO_BITS / 4) == std::string(POW_ZERO_BITS / 4, '0');
+			});
+
+		DecimalNonce nonce(FIRST_NONCE);
+		Measure("pow_nonce", backend, 1, guessLength, guessLength, [&]()
+			{
+				ourSink = lastProofContext.resumeMeetsTarget(reinterpret_cast<const unsigned char*>(nonce.GetData()), nonce.GetLength(), target);
+				nonce.Increment();
+			});
+
+		//Same loop as Miner: one buffer per lane, refilled from the incremented nonce
+		const size_t lanes = std::min(CU::sha256BatchLanes(), MAX_BATCH_LANES);
+		char proofs[MAX_BATCH_LANES][DecimalNonce::MAX_DIGITS + 1];
+		const unsigned char* messages[MAX_BATCH_LANES];
+		size_t lengths[MAX_BATCH_LANES];
+		for (size_t i = 0; i < MAX_BATCH_LANES; i++)
+		{
+			messages[i] = reinterpret_cast<const unsigned char*>(proofs[i]);
+		}
+		nonce.Set(FIRST_NONCE);
+		Measure("pow_nonce_batch", backend, lanes, guessLength, guessLength * lanes, [&]()
+			{
+				for (size_t i = 0; i < lanes; i++)
+				{
+					std::memcpy(proofs[i], nonce.GetData(), nonce.GetLength());
+					lengths[i] = nonce.GetLength();
+					nonce.Increment();
+				}
+				ourSink = static_cast<unsigned char>(lastProofContext.resumeBatchFind(messages, lengths, lanes, target));
+			});
+	}
+
+	template <class Function>
+	void Suite::Measure(const char* anApi, const std::string& aBackend, size_t aLanes, size_t aMessageSize, size_t aBytesPerCall, Function aFunction)
+	{
+		CU::StopWatch stopWatch;
+		aFunction();
+
+		//Doubles the call count until one sample is long enough for the clock resolution not to matter
+		size_t calls = 1;
+		while (true)
+		{
+			stopWatch.Start();
+			for (size_t i = 0; i < calls; i++)
+			{
+				aFunction();
+			}
+			stopWatch.Stop();
+			if (stopWatch.GetTime() >= mySettings.minSampleSeconds)
+			{
+				break;
+			}
+			calls *= 2;
+		}
+
+		std::vector<double> nsPerCall;
+		nsPerCall.reserve(mySettings.samples);
+		const uint64_t allocationsBefore = AllocationCounter::GetCount();
+		for (size_t sample = 0; sample < mySettings.samples; sample++)
+		{
+			stopWatch.Start();
+			for (size_t i = 0; i < calls; i++)
+			{
+				aFunction();
+			}
+			stopWatch.Stop();
+			nsPerCall.push_back(stopWatch.GetTime() * 1e9 / calls);
+		}
+		const uint64_t allocations = AllocationCounter::GetCount() - allocationsBefore;
+		std::sort(nsPerCall.begin(), nsPerCall.end());
+
+		//A batch call hashes BATCH_SIZE messages, latency is reported per message
+		const size_t messagesPerCall = aBytesPerCall / aMessageSize;
+		const double median = nsPerCall[nsPerCall.size() / 2] / messagesPerCall;
+		myResults.push_back({ anApi, aBackend, aLanes, aMessageSize, calls, mySettings.samples,
+			nsPerCall.front() / messagesPerCall, median, aMessageSize / median * 1e3,
+			static_cast<double>(allocations) / (calls * mySettings.samples * messagesPerCall) });
+	}
+
+	void Suite::WriteCsv(std::ostream& aStream) const
+	{
+		aStream << "api,backend,lanes,message_bytes,calls_per_sample,samples,ns_per_message_min,ns_per_message_median,mb_per_s,allocs_per_message\n";
+		aStream << std::fixed << std::setprecision(2);
+		for (const auto& result : myResults)
+		{
+			aStream << result.api << ',' << result.backend << ',' << result.lanes << ',' << result.messageSize << ','
+				<< result.callsPerSample << ',' << result.samples << ',' << result.minNsPerCall << ','
+				<< result.medianNsPerCall << ',' << result.megabytesPerSecond << ',' << result.allocationsPerMessage << '\n';
+		}
+	}
+
+	void Suite::WriteJson(std::ostream& aStream) const
+	{
+		aStream << std::boolalpha << std::fixed << std::setprecision(2);
+		aStream << "{\n  \"cpu\": { \"ssse3\": " << CU::CpuFeatures::HasSsse3() << ", \"sse4_1\": " << CU::CpuFeatures::HasSse41()
+			<< ", \"avx2\": " << CU::CpuFeatures::HasAvx2() << ", \"avx512f\": " << CU::CpuFeatures::HasAvx512F()
+			<< ", \"sha_ni\": " << CU::CpuFeatures::HasShaNi() << " },\n";
+		aStream << "  \"default_backend\": \"" << CU::sha256BackendName(CU::sha256Backend()) << "\",\n";
+		aStream << "  \"default_lanes\": " << CU::sha256BatchLanes() << ",\n";
+		aStream << "  \"results\": [";
+		for (size_t i = 0; i < myResults.size(); i++)
+		{
+			const auto& result = myResults[i];
+			aStream << (i == 0 ? "\n" : ",\n");
+			aStream << "    { \"api\": \"" << result.api << "\", \"backend\": \"" << result.backend << "\", \"lanes\": " << result.lanes
+				<< ", \"message_bytes\": " << result.messageSize << ", \"calls_per_sample\": " << result.callsPerSample
+				<< ", \"samples\": " << result.samples << ", \"ns_per_message_min\": " << result.minNsPerCall
+				<< ", \"ns_per_message_median\": " << result.medianNsPerCall << ", \"mb_per_s\": " << result.megabytesPerSecond
+				<< ", \"allocs_per_message\": " << result.allocationsPerMessage << " }";
+		}
+		aStream << "\n  ]\n}\n";
+	}
+
+	const std::vector<Result>& Suite::GetResults() const
+	{
+		return myResults;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Sha256Benchmark
+{
+	struct Result
+	{
+		std::string api;
+		std::string backend;
+		size_t lanes;
+		size_t messageSize;
+		size_t callsPerSample;
+		size_t samples;
+		double minNsPerCall;
+		double medianNsPerCall;
+		double megabytesPerSecond;
+		//Heap allocations per message seen by AllocationCounter
+		double allocationsPerMessage;
+	};
+
+	struct Settings
+	{
+		//Every sample runs at least this long, the iteration count is calibrated per case
+		double minSampleSeconds = 0.02;
+		size_t samples = 7;
+		size_t maxMessageSize = 8 << 20;
+	};
+
+	class Suite
+	{
+	public:
+		Suite(const Settings& someSettings);
+
+		//Runs every API on every available backend and lane count, then restores the startup choices
+		void Run();
+
+		void WriteCsv(std::ostream& aStream) const;
+		void WriteJson(std::ostream& aStream) const;
+
+		const std::vector<Result>& GetResults() const;
+
+	private:
+		template <class Function>
+		void Measure(const char* anApi, const std::string& aBackend, size_t aLanes, size_t aMessageSize, size_t aBytesPerCall, Function aFunction);
+
+		void RunSingle(const std::string& aBackend);
+		void RunBatch(size_t aLanes);
+		void RunProofOfWork();
+
+		Settings mySettings;
+		std::vector<size_t> myMessageSizes;
+		std::vector<unsigned char> myData;
+		std::vector<Result> myResults;
+	};
+}
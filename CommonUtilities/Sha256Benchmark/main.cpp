@@ -0,0 +1,61 @@
+#include "Sha256Benchmark.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+//Usage: Sha256Benchmark [--json] [--quick] [--out <path>]
+//CSV on stdout by default, --quick trades accuracy for a run of a few seconds
+int main(int argc, char* argv[])
+{
+	Sha256Benchmark::Settings settings;
+	bool json = false;
+	const char* outputPath = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--json") == 0)
+		{
+			json = true;
+		}
+		else if (std::strcmp(argv[i], "--quick") == 0)
+		{
+			settings.minSampleSeconds = 0.002;
+			settings.samples = 3;
+			settings.maxMessageSize = 1 << 20;
+		}
+		else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--json] [--quick] [--out <path>]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	Sha256Benchmark::Suite suite(settings);
+	suite.Run();
+
+	std::ofstream file;
+	if (outputPath)
+	{
+		file.open(outputPath);
+		if (!file)
+		{
+			std::cerr << "Can't write " << outputPath << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::ostream& output = outputPath ? file : std::cout;
+	if (json)
+	{
+		suite.WriteJson(output);
+	}
+	else
+	{
+		suite.WriteCsv(output);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#include "AddressTable.h"
+
+#include <cassert>
+#include <mutex>
+
+namespace emmaChain {
+	AddressTable::AddressTable()
+	{
+		mAddresses.emplace_back();
+		mIds.emplace(mAddresses.back(), 0);
+	}
+
+	AddressId AddressTable::Intern(std::string_view anAddress)
+	{
+		{
+			//Almost every address is already known, those only need the shared lock
+			std::shared_lock<std::shared_mutex> lock(mMutex);
+			auto found = mIds.find(anAddress);
+			if (found != mIds.end())
+			{
+				return found->second;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lock(mMutex);
+		auto found = mIds.find(anAddress);
+		if (found != mIds.end())
+		{
+			return found->second;
+		}
+		const AddressId id = static_cast<AddressId>(mAddresses.size());
+		mAddresses.emplace_back(anAddress);
+		mIds.emplace(mAddresses.back(), id);
+		return id;
+	}
+
+	bool AddressTable::Find(std::string_view anAddress, AddressId& anIdOut) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		auto found = mIds.find(anAddress);
+		if (found == mIds.end())
+		{
+			return false;
+		}
+		anIdOut = found->second;
+		return true;
+	}
+
+	const std::string& AddressTable::GetAddress(AddressId anId) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		assert(anId < mAddresses.size());
+		return mAddresses[anId];
+	}
+
+	size_t AddressTable::GetSize() const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		return mAddresses.size();
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace emmaChain {
+	typedef uint32_t AddressId;
+
+	//Every sender and recipient address of one node's committed blocks, each stored once.
+	//Addresses are only added for blocks that passed validation, so the table grows with the chain and not with what peers send.
+	//Ids only mean something inside the table, hashes, the block store and the JSON all carry the address itself.
+	class AddressTable {
+	public:
+		AddressTable();
+		AddressTable(const AddressTable& anAddressTable) = delete;
+		AddressTable& operator=(const AddressTable& anAddressTable) = delete;
+
+		//Id of anAddress, which is added on first use. The empty address is always id 0.
+		AddressId Intern(std::string_view anAddress);
+		//Like Intern() but never adds anything, false for an address no committed transaction has used
+		bool Find(std::string_view anAddress, AddressId& anIdOut) const;
+		//Addresses are never removed, the reference stays valid for the life of the table
+		const std::string& GetAddress(AddressId anId) const;
+		size_t GetSize() const;
+
+	private:
+		//A deque never moves its elements, so the map keys and the references GetAddress() hands out stay put
+		std::deque<std::string> mAddresses;
+		std::unordered_map<std::string_view, AddressId> mIds;
+		mutable std::shared_mutex mMutex;
+	};
+}
@@ -2,33 +2,87 @@
 
 #include <CommonUtilities/sha256/sha256.h>
 
-#include <sstream>
+#include <cstring>
+#include <ctime>
+#include <utility>
 
 namespace emmaChain {
-	Block::Block(uint32_t anIndexIn, int64_t aProof, const std::string& aPreviousHash, const std::vector<Transaction>& someTransactions)
-		: mTransactions(someTransactions)
+	namespace {
+		void UpdateBigEndian(CU::SHA256& aContext, uint32_t aValue)
+		{
+			const unsigned char bytes[4] = { static_cast<unsigned char>(aValue >> 24), static_cast<unsigned char>(aValue >> 16),
+				static_cast<unsigned char>(aValue >> 8), static_cast<unsigned char>(aValue) };
+			aContext.update(bytes, sizeof(bytes));
+		}
+
+		//Strings are length prefixed so moving characters between fields changes the hash
+		void UpdateString(CU::SHA256& aContext, std::string_view aString)
+		{
+			UpdateBigEndian(aContext, static_cast<uint32_t>(aString.size()));
+			aContext.update(aString);
+		}
+	}
+
+	Block::Block(uint32_t anIndexIn, int64_t aProof, const CU::SHA256Digest& aPreviousHash, BlockBody someTransactions, uint32_t aTargetBits)
+		: mTransactions(std::move(someTransactions))
 		, mPreviousHash(aPreviousHash)
 		, mProof(aProof)
 		, mIndex(anIndexIn)
+		, mTargetBits(aTargetBits)
+		, mTransactionsRoot(CalculateTransactionsRoot(mTransactions))
 	{
 		mTimestamp = time(nullptr);
+		const auto& bytes = GetHeader().Serialize();
+		CU::sha256Digest(bytes.data(), bytes.size(), mDigest.data());
 	}
 
-	Block::Block(uint32_t anIndexIn, int64_t aProof, const std::string& aPreviousHash, const std::vector<Transaction>& someTransactions, int64_t aTimestamp)
-		: mTransactions(someTransactions)
+	Block::Block(uint32_t anIndexIn, int64_t aProof, const CU::SHA256Digest& aPreviousHash, BlockBody someTransactions, int64_t aTimestamp, uint32_t aTargetBits)
+		: mTransactions(std::move(someTransactions))
 		, mPreviousHash(aPreviousHash)
 		, mTimestamp(aTimestamp)
 		, mProof(aProof)
 		, mIndex(anIndexIn)
+		, mTargetBits(aTargetBits)
+		, mTransactionsRoot(CalculateTransactionsRoot(mTransactions))
 	{
+		const auto& bytes = GetHeader().Serialize();
+		CU::sha256Digest(bytes.data(), bytes.size(), mDigest.data());
 	}
 
-	const std::vector<Transaction>& Block::GetTransactions() const
+	Block::Block(const BlockHeader& aHeader, BlockBody someTransactions, const CU::SHA256Digest& aDigest)
+		: mTransactions(std::move(someTransactions))
+		, mPreviousHash(aHeader.mPreviousHash)
+		, mTimestamp(aHeader.mTimestamp)
+		, mProof(static_cast<int64_t>(aHeader.mNonce))
+		, mIndex(aHeader.mIndex)
+		, mTargetBits(aHeader.mTargetBits)
+		, mTransactionsRoot(aHeader.mTransactionsRoot)
+		, mDigest(aDigest)
+	{
+	}
+
+	const BlockBody& Block::GetTransactions() const
 	{
 		return mTransactions;
 	}
 
-	const std::string& Block::GetPreviousHash() const
+	void Block::InternAddresses(const std::shared_ptr<AddressTable>& aTable)
+	{
+		mTransactions.Intern(aTable);
+	}
+
+	void Block::PruneBody()
+	{
+		mTransactions = BlockBody();
+		mHasBody = false;
+	}
+
+	bool Block::HasBody() const
+	{
+		return mHasBody;
+	}
+
+	const CU::SHA256Digest& Block::GetPreviousHash() const
 	{
 		return mPreviousHash;
 	}
@@ -48,10 +102,95 @@ namespace emmaChain {
 		return mIndex;
 	}
 
-	std::string Block::CalculateHash() const
+	uint32_t Block::GetTargetBits() const
+	{
+		return mTargetBits;
+	}
+
+	const CU::SHA256Digest& Block::GetDigest() const
+	{
+		return mDigest;
+	}
+
+	std::string Block::GetHash() const
+	{
+		return CU::sha256ToHex(mDigest);
+	}
+
+	BlockHeader Block::GetHeader() const
+	{
+		BlockHeader header;
+		header.mIndex = mIndex;
+		header.mTimestamp = mTimestamp;
+		header.mPreviousHash = mPreviousHash;
+		header.mTransactionsRoot = mTransactionsRoot;
+		header.mTargetBits = mTargetBits;
+		header.mNonce = static_cast<uint64_t>(mProof);
+		return header;
+	}
+
+	CU::SHA256Digest Block::CalculateTransactionsRoot(const BlockBody& someTransactions)
+	{
+		CU::SHA256Digest root{};
+		if (someTransactions.IsEmpty())
+		{
+			return root;
+		}
+
+		std::vector<CU::SHA256Digest> level;
+		level.reserve(someTransactions.GetCount());
+		for (const auto& transaction : someTransactions)
+		{
+			level.push_back(HashTransaction(transaction));
+		}
+
+		//Each level is one batch of 64 byte messages, two child hashes side by side
+		std::vector<unsigned char> pairs;
+		std::vector<const unsigned char*> messages;
+		std::vector<size_t> lengths;
+		while (level.size() > 1)
+		{
+			const size_t pairCount = level.size() / 2;
+			pairs.resize(pairCount * 2 * CU::SHA256::DIGEST_SIZE);
+			messages.resize(pairCount);
+			lengths.assign(pairCount, 2 * CU::SHA256::DIGEST_SIZE);
+			for (size_t i = 0; i < pairCount; i++)
+			{
+				unsigned char* pair = &pairs[i * 2 * CU::SHA256::DIGEST_SIZE];
+				std::memcpy(pair, level[2 * i].data(), CU::SHA256::DIGEST_SIZE);
+				std::memcpy(pair + CU::SHA256::DIGEST_SIZE, level[2 * i + 1].data(), CU::SHA256::DIGEST_SIZE);
+				messages[i] = pair;
+			}
+			//The unpaired last hash is the last parent as it is, the batch only writes the ones before it
+			if (level.size() % 2 != 0)
+			{
+				level[pairCount] = level.back();
+			}
+			level.resize((level.size() + 1) / 2);
+			CU::sha256Batch(messages.data(), lengths.data(), pairCount, level.front().data());
+		}
+		return level.front();
+	}
+
+	CU::SHA256Digest Block::HashTransaction(const TransactionView& aTransaction)
+	{
+		CU::SHA256 context;
+		UpdateString(context, aTransaction.GetSender());
+		UpdateString(context, aTransaction.GetRecipient());
+		UpdateString(context, aTransaction.mMessage);
+		UpdateBigEndian(context, aTransaction.mAmount);
+		CU::SHA256Digest digest;
+		context.final(digest.data());
+		return digest;
+	}
+
+	CU::SHA256Digest Block::HashPair(const CU::SHA256Digest& aLeft, const CU::SHA256Digest& aRight)
 	{
-		std::stringstream ss;
-		ss << mIndex << mTimestamp << mProof << mPreviousHash;
-		return CU::sha256(ss.str());
+		CU::SHA256 context;
+		context.update(aLeft.data(), aLeft.size());
+		context.update(aRight.data(), aRight.size());
+		CU::SHA256Digest digest;
+		context.final(digest.data());
+		return digest;
 	}
 }
\ No newline at end of file
@@ -1,29 +1,60 @@
 #pragma once
+#include "BlockBody.h"
+#include "BlockHeader.h"
 #include "Transaction.h"
 
+#include <CommonUtilities/sha256/sha256.h>
+
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace emmaChain {
 	class Block {
 	public:
-		Block(uint32_t anIndexIn, int64_t aProof, const std::string& aPreviousHash, const std::vector<Transaction>& someTransactions);
-		Block(uint32_t anIndexIn, int64_t aProof, const std::string& aPreviousHash, const std::vector<Transaction>& someTransactions, int64_t aTimestamp);
+		Block(uint32_t anIndexIn, int64_t aProof, const CU::SHA256Digest& aPreviousHash, BlockBody someTransactions, uint32_t aTargetBits);
+		Block(uint32_t anIndexIn, int64_t aProof, const CU::SHA256Digest& aPreviousHash, BlockBody someTransactions, int64_t aTimestamp, uint32_t aTargetBits);
+		//For a header that was already hashed, e.g. just mined or read back from the block store. aDigest is trusted.
+		Block(const BlockHeader& aHeader, BlockBody someTransactions, const CU::SHA256Digest& aDigest);
 
-		std::string CalculateHash() const;
+		//SHA-256 of GetHeader().Serialize(), the proof is the header nonce.
+		//A block can't change after construction, so the digest and transactions root are computed once there.
+		const CU::SHA256Digest& GetDigest() const;
+		//Hex of GetDigest(), for JSON
+		std::string GetHash() const;
+		BlockHeader GetHeader() const;
+		//Merkle root over the transaction hashes. The last hash of an odd level moves up unpaired, pairing it with itself
+		//would give a body with its last transactions repeated the same root. All zeros without transactions.
+		static CU::SHA256Digest CalculateTransactionsRoot(const BlockBody& someTransactions);
+		//Leaf of the transactions root
+		static CU::SHA256Digest HashTransaction(const TransactionView& aTransaction);
+		//Inner node of the transactions root
+		static CU::SHA256Digest HashPair(const CU::SHA256Digest& aLeft, const CU::SHA256Digest& aRight);
 
-		const std::vector<Transaction>& GetTransactions() const;
-		const std::string& GetPreviousHash() const;
+		const BlockBody& GetTransactions() const;
+		//See BlockBody::Intern(), the hashes don't change
+		void InternAddresses(const std::shared_ptr<AddressTable>& aTable);
+		//Frees the transactions, the header and hashes stay. A pruned block still links and validates, but has no transactions to serve.
+		void PruneBody();
+		//False after PruneBody(), a block without transactions has a body too
+		bool HasBody() const;
+		const CU::SHA256Digest& GetPreviousHash() const;
 		const time_t GetTimestamp() const;
 		int64_t GetProof() const;
 		int GetIndex() const;
+		uint32_t GetTargetBits() const;
 
 	private:
-		std::vector<Transaction> mTransactions;
-		std::string mPreviousHash;
+		BlockBody mTransactions;
+		//Hashes are kept binary, hex only exists in the JSON
+		CU::SHA256Digest mPreviousHash{};
 		time_t mTimestamp{};
 		int64_t mProof{};
 		uint32_t mIndex{};
+		uint32_t mTargetBits{};
+		CU::SHA256Digest mTransactionsRoot{};
+		CU::SHA256Digest mDigest{};
+		bool mHasBody{ true };
 	};
 }
\ No newline at end of file
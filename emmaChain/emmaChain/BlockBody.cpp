@@ -0,0 +1,176 @@
+#include "BlockBody.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace emmaChain {
+	namespace {
+		//Sender, recipient, amount, message offset and message size
+		constexpr size_t RECORD_WORDS = 5;
+	}
+
+	BlockBody::Iterator::Iterator(const BlockBody& aBody, size_t anIndex)
+		: mBody(&aBody)
+		, mIndex(anIndex)
+	{
+	}
+
+	TransactionView BlockBody::Iterator::operator*() const
+	{
+		return (*mBody)[mIndex];
+	}
+
+	BlockBody::Iterator& BlockBody::Iterator::operator++()
+	{
+		mIndex++;
+		return *this;
+	}
+
+	bool BlockBody::Iterator::operator==(const Iterator& anOther) const
+	{
+		return mIndex == anOther.mIndex;
+	}
+
+	bool BlockBody::Iterator::operator!=(const Iterator& anOther) const
+	{
+		return mIndex != anOther.mIndex;
+	}
+
+	BlockBody::BlockBody(const std::vector<Transaction>& someTransactions)
+	{
+		size_t messageSize = 0;
+		for (const auto& transaction : someTransactions)
+		{
+			messageSize += transaction.mMessage.size();
+		}
+		Allocate(someTransactions.size(), messageSize);
+
+		size_t messageOffset = 0;
+		AddressIds ids;
+		for (size_t i = 0; i < someTransactions.size(); i++)
+		{
+			Write(i, someTransactions[i], messageOffset, ids);
+		}
+	}
+
+	BlockBody::BlockBody(const std::vector<Transaction>& someTransactions, const Transaction& aLast)
+	{
+		size_t messageSize = aLast.mMessage.size();
+		for (const auto& transaction : someTransactions)
+		{
+			messageSize += transaction.mMessage.size();
+		}
+		Allocate(someTransactions.size() + 1, messageSize);
+
+		size_t messageOffset = 0;
+		AddressIds ids;
+		for (size_t i = 0; i < someTransactions.size(); i++)
+		{
+			Write(i, someTransactions[i], messageOffset, ids);
+		}
+		Write(someTransactions.size(), aLast, messageOffset, ids);
+	}
+
+	TransactionView BlockBody::operator[](size_t anIndex) const
+	{
+		const uint32_t* record = &mData[anIndex * RECORD_WORDS];
+		return TransactionView(GetAddress(record[0]), GetAddress(record[1]), std::string_view(GetMessages() + record[3], record[4]), record[2]);
+	}
+
+	BlockBody::Iterator BlockBody::begin() const
+	{
+		return Iterator(*this, 0);
+	}
+
+	BlockBody::Iterator BlockBody::end() const
+	{
+		return Iterator(*this, mCount);
+	}
+
+	size_t BlockBody::GetCount() const
+	{
+		return mCount;
+	}
+
+	bool BlockBody::IsEmpty() const
+	{
+		return mCount == 0;
+	}
+
+	void BlockBody::Intern(const std::shared_ptr<AddressTable>& aTable)
+	{
+		if (mAddresses == aTable)
+		{
+			return;
+		}
+		for (size_t i = 0; i < mCount; i++)
+		{
+			uint32_t* record = &mData[i * RECORD_WORDS];
+			record[0] = aTable->Intern(GetAddress(record[0]));
+			record[1] = aTable->Intern(GetAddress(record[1]));
+		}
+		mAddresses = aTable;
+		mOwnAddresses = std::vector<std::string>();
+	}
+
+	bool BlockBody::IsInterned() const
+	{
+		return mAddresses != nullptr;
+	}
+
+	AddressId BlockBody::GetSenderId(size_t anIndex) const
+	{
+		assert(IsInterned());
+		return mData[anIndex * RECORD_WORDS];
+	}
+
+	AddressId BlockBody::GetRecipientId(size_t anIndex) const
+	{
+		assert(IsInterned());
+		return mData[anIndex * RECORD_WORDS + 1];
+	}
+
+	uint32_t BlockBody::AddAddress(const std::string& anAddress, AddressIds& someIds)
+	{
+		//Keyed by the caller's strings, mOwnAddresses moves its strings as it grows
+		const auto added = someIds.emplace(anAddress, static_cast<uint32_t>(mOwnAddresses.size()));
+		if (added.second)
+		{
+			mOwnAddresses.push_back(anAddress);
+		}
+		return added.first->second;
+	}
+
+	const std::string& BlockBody::GetAddress(uint32_t anId) const
+	{
+		return mAddresses ? mAddresses->GetAddress(anId) : mOwnAddresses[anId];
+	}
+
+	void BlockBody::Allocate(size_t aCount, size_t aMessageSize)
+	{
+		mCount = aCount;
+		mData.resize(aCount * RECORD_WORDS + (aMessageSize + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+	}
+
+	void BlockBody::Write(size_t anIndex, const Transaction& aTransaction, size_t& aMessageOffset, AddressIds& someIds)
+	{
+		uint32_t* record = &mData[anIndex * RECORD_WORDS];
+		record[0] = AddAddress(aTransaction.mSender, someIds);
+		record[1] = AddAddress(aTransaction.mRecipient, someIds);
+		record[2] = aTransaction.mAmount;
+		record[3] = static_cast<uint32_t>(aMessageOffset);
+		record[4] = static_cast<uint32_t>(aTransaction.mMessage.size());
+		std::memcpy(GetMessages() + aMessageOffset, aTransaction.mMessage.data(), aTransaction.mMessage.size());
+		aMessageOffset += aTransaction.mMessage.size();
+	}
+
+	char* BlockBody::GetMessages()
+	{
+		return reinterpret_cast<char*>(mData.data() + mCount * RECORD_WORDS);
+	}
+
+	const char* BlockBody::GetMessages() const
+	{
+		return reinterpret_cast<const char*>(mData.data() + mCount * RECORD_WORDS);
+	}
+}
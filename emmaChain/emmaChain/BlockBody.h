@@ -0,0 +1,69 @@
+#pragma once
+#include "AddressTable.h"
+#include "Transaction.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace emmaChain {
+	//The transactions of one block in a single allocation: a fixed size record per transaction, then every message back to back.
+	//Building or copying a body allocates once however many transactions it holds, and a scan reads one buffer front to back.
+	//A new body keeps its own list of the addresses it uses. Intern() moves them to a node's AddressTable once the block is
+	//committed, so blocks that fail validation never add to the table.
+	class BlockBody {
+	public:
+		class Iterator {
+		public:
+			Iterator(const BlockBody& aBody, size_t anIndex);
+
+			TransactionView operator*() const;
+			Iterator& operator++();
+			bool operator==(const Iterator& anOther) const;
+			bool operator!=(const Iterator& anOther) const;
+
+		private:
+			const BlockBody* mBody;
+			size_t mIndex;
+		};
+
+		BlockBody() = default;
+		BlockBody(const std::vector<Transaction>& someTransactions);
+		//someTransactions followed by aLast, e.g. the pending transactions and a mining reward
+		BlockBody(const std::vector<Transaction>& someTransactions, const Transaction& aLast);
+
+		TransactionView operator[](size_t anIndex) const;
+		Iterator begin() const;
+		Iterator end() const;
+		size_t GetCount() const;
+		bool IsEmpty() const;
+
+		//Swaps the body's own addresses for ids in aTable, also if it was interned in another table before
+		void Intern(const std::shared_ptr<AddressTable>& aTable);
+		bool IsInterned() const;
+		//Ids in the table of the last Intern(), only valid once IsInterned()
+		AddressId GetSenderId(size_t anIndex) const;
+		AddressId GetRecipientId(size_t anIndex) const;
+
+	private:
+		typedef std::unordered_map<std::string_view, uint32_t> AddressIds;
+
+		uint32_t AddAddress(const std::string& anAddress, AddressIds& someIds);
+		const std::string& GetAddress(uint32_t anId) const;
+		void Allocate(size_t aCount, size_t aMessageSize);
+		void Write(size_t anIndex, const Transaction& aTransaction, size_t& aMessageOffset, AddressIds& someIds);
+		char* GetMessages();
+		const char* GetMessages() const;
+
+		//mCount records of RECORD_WORDS words, then the messages
+		std::vector<uint32_t> mData;
+		size_t mCount{};
+		//Sender and recipient in the records index mAddresses once interned, mOwnAddresses before
+		std::shared_ptr<const AddressTable> mAddresses;
+		std::vector<std::string> mOwnAddresses;
+	};
+}
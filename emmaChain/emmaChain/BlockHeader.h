@@ -0,0 +1,145 @@
+#pragma once
+#include <CommonUtilities/sha256/sha256.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace emmaChain {
+	//Everything a block hash and its proof of work commit to, in a fixed big-endian layout.
+	//SIZE is below 119 bytes, so hashing it takes two compressions and a mining attempt only the second one.
+	struct BlockHeader {
+		static constexpr uint32_t VERSION = 1;
+		static constexpr size_t SIZE = 92;
+		static constexpr size_t TARGET_BITS_OFFSET = 80;
+		//The nonce comes last so the hash state of everything before it is computed once per mining run
+		static constexpr size_t NONCE_OFFSET = 84;
+		static constexpr size_t NONCE_SIZE = 8;
+
+		typedef std::array<uint8_t, SIZE> Bytes;
+
+		constexpr Bytes Serialize() const
+		{
+			Bytes bytes{};
+			size_t offset = 0;
+			WriteBigEndian(bytes, offset, mVersion, 4);
+			WriteBigEndian(bytes, offset, mIndex, 4);
+			WriteBigEndian(bytes, offset, static_cast<uint64_t>(mTimestamp), 8);
+			for (uint8_t byte : mPreviousHash)
+			{
+				bytes[offset++] = byte;
+			}
+			for (uint8_t byte : mTransactionsRoot)
+			{
+				bytes[offset++] = byte;
+			}
+			WriteBigEndian(bytes, offset, mTargetBits, 4);
+			WriteBigEndian(bytes, offset, mNonce, NONCE_SIZE);
+			return bytes;
+		}
+
+		//Inverse of Serialize(), someBytes has to hold SIZE bytes
+		static BlockHeader Deserialize(const unsigned char* someBytes)
+		{
+			size_t offset = 0;
+			BlockHeader header;
+			header.mVersion = static_cast<uint32_t>(ReadBigEndian(someBytes, offset, 4));
+			header.mIndex = static_cast<uint32_t>(ReadBigEndian(someBytes, offset, 4));
+			header.mTimestamp = static_cast<int64_t>(ReadBigEndian(someBytes, offset, 8));
+			for (auto& byte : header.mPreviousHash)
+			{
+				byte = someBytes[offset++];
+			}
+			for (auto& byte : header.mTransactionsRoot)
+			{
+				byte = someBytes[offset++];
+			}
+			header.mTargetBits = static_cast<uint32_t>(ReadBigEndian(someBytes, offset, 4));
+			header.mNonce = ReadBigEndian(someBytes, offset, NONCE_SIZE);
+			return header;
+		}
+
+		//Nonce bytes as they appear at NONCE_OFFSET
+		static void WriteNonce(uint64_t aNonce, unsigned char* aBytesOut)
+		{
+			for (size_t i = 0; i < NONCE_SIZE; i++)
+			{
+				aBytesOut[i] = static_cast<unsigned char>(aNonce >> (8 * (NONCE_SIZE - 1 - i)));
+			}
+		}
+
+		static uint32_t ReadTargetBits(const Bytes& someBytes)
+		{
+			uint32_t bits = 0;
+			for (size_t i = 0; i < 4; i++)
+			{
+				bits = (bits << 8) | someBytes[TARGET_BITS_OFFSET + i];
+			}
+			return bits;
+		}
+
+		static uint64_t ReadBigEndian(const unsigned char* someBytes, size_t& anOffset, size_t aSize)
+		{
+			uint64_t value = 0;
+			for (size_t i = 0; i < aSize; i++)
+			{
+				value = (value << 8) | someBytes[anOffset++];
+			}
+			return value;
+		}
+
+		static constexpr void WriteBigEndian(Bytes& someBytes, size_t& anOffset, uint64_t aValue, size_t aSize)
+		{
+			for (size_t i = 0; i < aSize; i++)
+			{
+				someBytes[anOffset++] = static_cast<uint8_t>(aValue >> (8 * (aSize - 1 - i)));
+			}
+		}
+
+		uint32_t mVersion{ VERSION };
+		uint32_t mIndex{};
+		int64_t mTimestamp{};
+		CU::SHA256Digest mPreviousHash{};
+		CU::SHA256Digest mTransactionsRoot{};
+		//CU::sha256TargetToCompact() of the target the block was mined against
+		uint32_t mTargetBits{};
+		uint64_t mNonce{};
+	};
+
+	//Nonce candidates for CU::SHA256::resumeBatchFind() on a context that absorbed the header up to NONCE_OFFSET.
+	//The buffers are fixed, so an attempt does no heap allocation. Shared by the local miner and the worker processes.
+	struct NonceBatch {
+		//Widest batch sha256BatchLanes() reports (AVX-512)
+		static constexpr size_t MAX_LANES = 16;
+
+		NonceBatch()
+			: mLanes(std::min(CU::sha256BatchLanes(), MAX_LANES))
+		{
+			for (size_t i = 0; i < MAX_LANES; i++)
+			{
+				mMessages[i] = mNonces[i];
+				mLengths[i] = BlockHeader::NONCE_SIZE;
+			}
+		}
+		//mMessages points into the batch itself
+		NonceBatch(const NonceBatch&) = delete;
+		NonceBatch& operator=(const NonceBatch&) = delete;
+
+		//Tries the aCount nonces from aFirst on, at most mLanes. Index of the first whose header meets aTarget, aCount if none does.
+		size_t Find(const CU::SHA256& aHeaderContext, uint64_t aFirst, size_t aCount, const CU::SHA256Target& aTarget)
+		{
+			for (size_t i = 0; i < aCount; i++)
+			{
+				BlockHeader::WriteNonce(aFirst + i, mNonces[i]);
+			}
+			return aHeaderContext.resumeBatchFind(mMessages, mLengths, aCount, aTarget);
+		}
+
+		//Nonces one batch pass hashes at once
+		const size_t mLanes;
+		unsigned char mNonces[MAX_LANES][BlockHeader::NONCE_SIZE];
+		const unsigned char* mMessages[MAX_LANES];
+		size_t mLengths[MAX_LANES];
+	};
+}
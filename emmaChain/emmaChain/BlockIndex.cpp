@@ -0,0 +1,80 @@
+#include "BlockIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace emmaChain {
+	namespace {
+		constexpr size_t INITIAL_SLOTS = 1024;
+	}
+
+	void BlockIndex::Insert(const CU::SHA256Digest& aDigest, uint32_t aHeight)
+	{
+		//Kept at most half full, so probes stay short
+		if (2 * (mSize + 1) > mSlots.size())
+		{
+			Grow();
+		}
+		Slot& slot = mSlots[FindSlot(aDigest)];
+		if (slot.mHeightPlusOne == 0)
+		{
+			slot.mDigest = aDigest;
+			mSize++;
+		}
+		slot.mHeightPlusOne = aHeight + 1;
+	}
+
+	bool BlockIndex::Find(const CU::SHA256Digest& aDigest, uint32_t& aHeightOut) const
+	{
+		if (mSlots.empty())
+		{
+			return false;
+		}
+		const Slot& slot = mSlots[FindSlot(aDigest)];
+		if (slot.mHeightPlusOne == 0)
+		{
+			return false;
+		}
+		aHeightOut = slot.mHeightPlusOne - 1;
+		return true;
+	}
+
+	void BlockIndex::Clear()
+	{
+		mSlots.clear();
+		mSize = 0;
+	}
+
+	size_t BlockIndex::GetSize() const
+	{
+		return mSize;
+	}
+
+	size_t BlockIndex::FindSlot(const CU::SHA256Digest& aDigest) const
+	{
+		//The slot count is a power of two
+		const size_t mask = mSlots.size() - 1;
+		uint64_t hash;
+		std::memcpy(&hash, aDigest.data(), sizeof(hash));
+		size_t slot = static_cast<size_t>(hash) & mask;
+		while (mSlots[slot].mHeightPlusOne != 0 && mSlots[slot].mDigest != aDigest)
+		{
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	void BlockIndex::Grow()
+	{
+		std::vector<Slot> oldSlots(std::max(INITIAL_SLOTS, 2 * mSlots.size()));
+		std::swap(oldSlots, mSlots);
+		for (const Slot& slot : oldSlots)
+		{
+			if (slot.mHeightPlusOne != 0)
+			{
+				mSlots[FindSlot(slot.mDigest)] = slot;
+			}
+		}
+	}
+}
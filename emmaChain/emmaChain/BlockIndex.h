@@ -0,0 +1,32 @@
+#pragma once
+#include <CommonUtilities/sha256/sha256.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace emmaChain {
+	//Block digest to height, as an open-addressing table with linear probing.
+	//Digests are already uniformly distributed, so their first bytes serve as the slot hash.
+	class BlockIndex {
+	public:
+		void Insert(const CU::SHA256Digest& aDigest, uint32_t aHeight);
+		bool Find(const CU::SHA256Digest& aDigest, uint32_t& aHeightOut) const;
+		//Entries can't be removed one by one without tombstones, a replaced chain is indexed from scratch instead
+		void Clear();
+		size_t GetSize() const;
+
+	private:
+		struct Slot
+		{
+			CU::SHA256Digest mDigest{};
+			//Height + 1, 0 marks an empty slot
+			uint32_t mHeightPlusOne{};
+		};
+
+		size_t FindSlot(const CU::SHA256Digest& aDigest) const;
+		void Grow();
+
+		std::vector<Slot> mSlots;
+		size_t mSize{};
+	};
+}
@@ -0,0 +1,395 @@
+#include "BlockStore.h"
+
+#include <CommonUtilities/MemoryMappedFile.h>
+
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace emmaChain {
+	namespace {
+		constexpr uint32_t RECORD_MAGIC = 0x45424c4b; //"EBLK"
+		//Leading bytes of the payload's SHA-256
+		constexpr size_t CHECKSUM_SIZE = 8;
+		constexpr size_t RECORD_OVERHEAD = 4 + 4 + CHECKSUM_SIZE;
+		//Offset, record size and digest
+		constexpr size_t INDEX_ENTRY_SIZE = 8 + 4 + CU::SHA256::DIGEST_SIZE;
+		//Sender, recipient and message length prefixes and the amount, a transaction with three empty strings
+		constexpr size_t MIN_TRANSACTION_SIZE = 4 + 4 + 4 + 4;
+
+		void AppendBigEndian(std::string& aBuffer, uint64_t aValue, size_t aSize)
+		{
+			for (size_t i = 0; i < aSize; i++)
+			{
+				aBuffer.push_back(static_cast<char>(aValue >> (8 * (aSize - 1 - i))));
+			}
+		}
+
+		uint64_t ReadBigEndian(const unsigned char* someBytes, size_t aSize)
+		{
+			uint64_t value = 0;
+			for (size_t i = 0; i < aSize; i++)
+			{
+				value = (value << 8) | someBytes[i];
+			}
+			return value;
+		}
+
+		void AppendString(std::string& aBuffer, std::string_view aString)
+		{
+			AppendBigEndian(aBuffer, aString.size(), 4);
+			aBuffer += aString;
+		}
+
+		//Moves aCursor past the string, false if it would run past anEnd
+		bool ReadString(const unsigned char*& aCursor, const unsigned char* anEnd, std::string& aStringOut)
+		{
+			if (anEnd - aCursor < 4)
+			{
+				return false;
+			}
+			const size_t size = static_cast<size_t>(ReadBigEndian(aCursor, 4));
+			aCursor += 4;
+			if (static_cast<size_t>(anEnd - aCursor) < size)
+			{
+				return false;
+			}
+			aStringOut.assign(reinterpret_cast<const char*>(aCursor), size);
+			aCursor += size;
+			return true;
+		}
+
+		//aDigest comes from the index, the header isn't hashed again
+		bool DecodePayload(const unsigned char* aPayload, size_t aSize, const CU::SHA256Digest& aDigest, std::vector<Block>& someBlocksOut)
+		{
+			if (aSize < BlockHeader::SIZE + 4)
+			{
+				return false;
+			}
+			const BlockHeader header = BlockHeader::Deserialize(aPayload);
+			const unsigned char* cursor = aPayload + BlockHeader::SIZE;
+			const unsigned char* end = aPayload + aSize;
+			const uint32_t transactionCount = static_cast<uint32_t>(ReadBigEndian(cursor, 4));
+			cursor += 4;
+			//The count comes from the file, it has to fit in what is left before anything is allocated for it
+			if (transactionCount > static_cast<size_t>(end - cursor) / MIN_TRANSACTION_SIZE)
+			{
+				return false;
+			}
+
+			std::vector<Transaction> transactions(transactionCount);
+			for (auto& transaction : transactions)
+			{
+				if (!ReadString(cursor, end, transaction.mSender) || !ReadString(cursor, end, transaction.mRecipient)
+					|| !ReadString(cursor, end, transaction.mMessage) || end - cursor < 4)
+				{
+					return false;
+				}
+				transaction.mAmount = static_cast<uint32_t>(ReadBigEndian(cursor, 4));
+				cursor += 4;
+			}
+
+			someBlocksOut.push_back(Block(header, transactions, aDigest));
+			return cursor == end;
+		}
+
+		//aRecord holds aSize bytes, its checksum is checked before anything in it is decoded
+		bool DecodeRecord(const unsigned char* aRecord, size_t aSize, const CU::SHA256Digest& aDigest, std::vector<Block>& someBlocksOut)
+		{
+			const size_t payloadSize = aSize - RECORD_OVERHEAD;
+			const unsigned char* payload = aRecord + 8;
+			CU::SHA256Digest checksum;
+			CU::sha256Digest(payload, payloadSize, checksum.data());
+			return ReadBigEndian(aRecord, 4) == RECORD_MAGIC && ReadBigEndian(aRecord + 4, 4) == payloadSize
+				&& std::memcmp(checksum.data(), payload + payloadSize, CHECKSUM_SIZE) == 0 && DecodePayload(payload, payloadSize, aDigest, someBlocksOut);
+		}
+	}
+
+	bool BlockStore::Open(const std::string& aDirectory)
+	{
+		Close();
+		std::error_code error;
+		std::filesystem::create_directories(aDirectory, error);
+		mLogPath = (std::filesystem::path(aDirectory) / "blocks.log").string();
+		mIndexPath = (std::filesystem::path(aDirectory) / "blocks.idx").string();
+
+		uint64_t logSize = std::filesystem::file_size(mLogPath, error);
+		if (error)
+		{
+			//A missing log counts as empty
+			logSize = 0;
+		}
+
+		//Entries are checked against the log only as far as they fit, a crash can leave either file ahead of the other
+		CU::MemoryMappedFile index;
+		uint64_t validLogSize = 0;
+		if (index.Open(mIndexPath))
+		{
+			const size_t entryCount = index.GetSize() / INDEX_ENTRY_SIZE;
+			mIndex.reserve(entryCount);
+			for (size_t i = 0; i < entryCount; i++)
+			{
+				const unsigned char* bytes = index.GetData() + i * INDEX_ENTRY_SIZE;
+				IndexEntry entry;
+				entry.mOffset = ReadBigEndian(bytes, 8);
+				entry.mSize = static_cast<uint32_t>(ReadBigEndian(bytes + 8, 4));
+				std::memcpy(entry.mDigest.data(), bytes + 12, entry.mDigest.size());
+				if (entry.mOffset != validLogSize || entry.mSize < RECORD_OVERHEAD || entry.mOffset + entry.mSize > logSize)
+				{
+					break;
+				}
+				validLogSize += entry.mSize;
+				mIndex.push_back(entry);
+			}
+			index.Close();
+		}
+
+		if (!Resize(mIndex.size(), validLogSize))
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void BlockStore::Close()
+	{
+		mLog.close();
+		mIndexFile.close();
+		mIndex.clear();
+		mLogSize = 0;
+	}
+
+	bool BlockStore::IsOpen() const
+	{
+		return mLog.is_open() && mIndexFile.is_open();
+	}
+
+	size_t BlockStore::GetBlockCount() const
+	{
+		return mIndex.size();
+	}
+
+	const CU::SHA256Digest& BlockStore::GetDigest(size_t anIndex) const
+	{
+		return mIndex[anIndex].mDigest;
+	}
+
+	bool BlockStore::Load(std::vector<Block>& someBlocksOut)
+	{
+		someBlocksOut.clear();
+		if (mIndex.empty())
+		{
+			return true;
+		}
+		//Our own appends go through mLog, so they have to reach the file before it is mapped
+		mLog.flush();
+		CU::MemoryMappedFile log;
+		if (!log.Open(mLogPath) || log.GetSize() < mLogSize)
+		{
+			return false;
+		}
+
+		someBlocksOut.reserve(mIndex.size());
+		for (size_t i = 0; i < mIndex.size(); i++)
+		{
+			//Only the framing is checked, the checksum covers the body and is left to ReadRecords()
+			const IndexEntry& entry = mIndex[i];
+			const unsigned char* record = log.GetData() + entry.mOffset;
+			if (entry.mSize < RECORD_OVERHEAD + BlockHeader::SIZE || ReadBigEndian(record, 4) != RECORD_MAGIC
+				|| ReadBigEndian(record + 4, 4) != entry.mSize - RECORD_OVERHEAD)
+			{
+				log.Close();
+				Truncate(i);
+				return true;
+			}
+			someBlocksOut.push_back(Block(BlockHeader::Deserialize(record + 8), BlockBody(), entry.mDigest));
+			someBlocksOut.back().PruneBody();
+		}
+		return true;
+	}
+
+	bool BlockStore::Read(size_t anIndex, std::optional<Block>& aBlockOut) const
+	{
+		if (anIndex >= mIndex.size())
+		{
+			return false;
+		}
+		std::vector<Block> blocks;
+		if (!ReadRecords(mLogPath, { mIndex[anIndex] }, blocks))
+		{
+			return false;
+		}
+		aBlockOut = std::move(blocks.front());
+		return true;
+	}
+
+	bool BlockStore::GetIndexEntry(size_t anIndex, IndexEntry& anEntryOut) const
+	{
+		if (anIndex >= mIndex.size())
+		{
+			return false;
+		}
+		anEntryOut = mIndex[anIndex];
+		return true;
+	}
+
+	const std::string& BlockStore::GetLogPath() const
+	{
+		return mLogPath;
+	}
+
+	bool BlockStore::Append(const Block& aBlock)
+	{
+		const auto& header = aBlock.GetHeader().Serialize();
+		std::string payload(header.begin(), header.end());
+		AppendBigEndian(payload, aBlock.GetTransactions().GetCount(), 4);
+		for (const auto& transaction : aBlock.GetTransactions())
+		{
+			AppendString(payload, transaction.GetSender());
+			AppendString(payload, transaction.GetRecipient());
+			AppendString(payload, transaction.mMessage);
+			AppendBigEndian(payload, transaction.mAmount, 4);
+		}
+		CU::SHA256Digest checksum = CU::sha256Digest(payload);
+
+		std::string record;
+		record.reserve(payload.size() + RECORD_OVERHEAD);
+		AppendBigEndian(record, RECORD_MAGIC, 4);
+		AppendBigEndian(record, payload.size(), 4);
+		record += payload;
+		record.append(reinterpret_cast<const char*>(checksum.data()), CHECKSUM_SIZE);
+
+		IndexEntry entry;
+		entry.mOffset = mLogSize;
+		entry.mSize = static_cast<uint32_t>(record.size());
+		entry.mDigest = aBlock.GetDigest();
+		std::string indexBytes;
+		AppendBigEndian(indexBytes, entry.mOffset, 8);
+		AppendBigEndian(indexBytes, entry.mSize, 4);
+		indexBytes.append(reinterpret_cast<const char*>(entry.mDigest.data()), entry.mDigest.size());
+
+		//The record goes out first, an index entry never points at bytes that aren't written yet
+		mLog.write(record.data(), record.size());
+		mLog.flush();
+		if (!mLog)
+		{
+			return false;
+		}
+		mIndexFile.write(indexBytes.data(), indexBytes.size());
+		mIndexFile.flush();
+		if (!mIndexFile)
+		{
+			return false;
+		}
+		mLogSize += record.size();
+		mIndex.push_back(entry);
+		return true;
+	}
+
+	bool BlockStore::Truncate(size_t aCount)
+	{
+		if (aCount >= mIndex.size())
+		{
+			return true;
+		}
+		const uint64_t logSize = mIndex[aCount].mOffset;
+		mIndex.resize(aCount);
+		return Resize(aCount, logSize);
+	}
+
+	size_t BlockStore::GetRecordSize(const unsigned char* someBytes, size_t aSize, size_t anOffset)
+	{
+		if (anOffset > aSize || aSize - anOffset < RECORD_OVERHEAD || ReadBigEndian(someBytes + anOffset, 4) != RECORD_MAGIC)
+		{
+			return 0;
+		}
+		const uint64_t recordSize = ReadBigEndian(someBytes + anOffset + 4, 4) + RECORD_OVERHEAD;
+		return recordSize <= aSize - anOffset ? static_cast<size_t>(recordSize) : 0;
+	}
+
+	bool BlockStore::ReadRecords(const std::string& aLogPath, const std::vector<IndexEntry>& someEntries, std::vector<Block>& someBlocksOut)
+	{
+		//Append() flushes every record, a separate stream sees all of them
+		std::ifstream log(aLogPath, std::ios::binary);
+		std::vector<unsigned char> record;
+		uint64_t position = 0;
+		for (const IndexEntry& entry : someEntries)
+		{
+			//Entries in height order are in log order, the stream then only seeks when records are skipped
+			if (entry.mOffset != position && !log.seekg(static_cast<std::streamoff>(entry.mOffset)))
+			{
+				return false;
+			}
+			record.resize(entry.mSize);
+			std::optional<Block> block;
+			if (!log.read(reinterpret_cast<char*>(record.data()), record.size())
+				|| !DecodeUntrustedRecord(record.data(), record.size(), block) || block->GetDigest() != entry.mDigest)
+			{
+				return false;
+			}
+			position = entry.mOffset + entry.mSize;
+			someBlocksOut.push_back(std::move(*block));
+		}
+		return true;
+	}
+
+	bool BlockStore::DecodeUntrustedRecord(const unsigned char* aRecord, size_t aSize, std::optional<Block>& aBlockOut)
+	{
+		if (aSize < RECORD_OVERHEAD + BlockHeader::SIZE)
+		{
+			return false;
+		}
+		//The payload starts with the serialized header, which is exactly what the block hash covers.
+		//Block doesn't keep the version, any other would make GetHeader() hash to something else.
+		if (BlockHeader::Deserialize(aRecord + 8).mVersion != BlockHeader::VERSION)
+		{
+			return false;
+		}
+		CU::SHA256Digest digest;
+		CU::sha256Digest(aRecord + 8, BlockHeader::SIZE, digest.data());
+		std::vector<Block> blocks;
+		if (!DecodeRecord(aRecord, aSize, digest, blocks))
+		{
+			return false;
+		}
+		aBlockOut = std::move(blocks.front());
+		return true;
+	}
+
+	bool BlockStore::OpenStreams()
+	{
+		mLog.open(mLogPath, std::ios::binary | std::ios::app);
+		mIndexFile.open(mIndexPath, std::ios::binary | std::ios::app);
+		return IsOpen();
+	}
+
+	bool BlockStore::Resize(size_t aCount, uint64_t aLogSize)
+	{
+		mLog.close();
+		mIndexFile.close();
+		//Creates the files if they are missing, resize_file needs them to exist
+		if (!OpenStreams())
+		{
+			return false;
+		}
+		mLog.close();
+		mIndexFile.close();
+
+		std::error_code error;
+		std::filesystem::resize_file(mLogPath, aLogSize, error);
+		if (error)
+		{
+			return false;
+		}
+		std::filesystem::resize_file(mIndexPath, aCount * INDEX_ENTRY_SIZE, error);
+		if (error)
+		{
+			return false;
+		}
+		mLogSize = aLogSize;
+		return OpenStreams();
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "Block.h"
+
+#include <CommonUtilities/sha256/sha256.h>
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace emmaChain {
+	//Append-only block log with a fixed-size index entry per block, so a node restarts from disk instead of from its peers.
+	//A record is a magic, the payload size, the payload (binary header and transactions) and a checksum of the payload.
+	//Index entries hold where the record is and the block digest, which is all the chain tip needs.
+	class BlockStore {
+	public:
+		//Where a block's record is in the log
+		struct IndexEntry
+		{
+			uint64_t mOffset{};
+			uint32_t mSize{};
+			CU::SHA256Digest mDigest{};
+		};
+
+		BlockStore() = default;
+		BlockStore(const BlockStore& aBlockStore) = delete;
+		BlockStore& operator=(const BlockStore& aBlockStore) = delete;
+
+		//Opens or creates blocks.log and blocks.idx in aDirectory. A record or entry torn by a crash is cut off.
+		bool Open(const std::string& aDirectory);
+		void Close();
+		bool IsOpen() const;
+
+		size_t GetBlockCount() const;
+		const CU::SHA256Digest& GetDigest(size_t anIndex) const;
+		//The stored headers from a mapping of the log, as pruned blocks (see Block::PruneBody()) with the digests of the index.
+		//Nothing is hashed or checksummed, so this only touches the headers however long the chain is. Bodies are read with
+		//ReadRecords(), which checks them. Blocks from the first record with a bad magic or size on are dropped from the store.
+		bool Load(std::vector<Block>& someBlocksOut);
+		//One block with its transactions, e.g. one pruned from memory. False if it isn't stored or its record is damaged.
+		bool Read(size_t anIndex, std::optional<Block>& aBlockOut) const;
+		bool GetIndexEntry(size_t anIndex, IndexEntry& anEntryOut) const;
+		const std::string& GetLogPath() const;
+		bool Append(const Block& aBlock);
+		//Keeps the first aCount blocks, for when the chain was replaced from there on
+		bool Truncate(size_t aCount);
+
+		//For reading a log without its index, e.g. a copy of another node's blocks.log.
+		//Size of the record at anOffset of the aSize bytes at someBytes, 0 unless a whole record with the right magic is there.
+		static size_t GetRecordSize(const unsigned char* someBytes, size_t aSize, size_t anOffset);
+		//Checks the checksum and decodes the record, which has to be GetRecordSize() bytes. Unlike Load() nothing comes from
+		//an index, the digest is hashed from the stored header. The transactions root is still only what the header says.
+		static bool DecodeUntrustedRecord(const unsigned char* aRecord, size_t aSize, std::optional<Block>& aBlockOut);
+		//Reads the records of someEntries from the log at aLogPath through one stream, without the store itself, so a caller
+		//can read while another thread appends. Each header is hashed and has to match its entry, a record replaced since the
+		//entries were taken counts as damaged. Stops at the first damaged record, false then, the blocks before it stay.
+		static bool ReadRecords(const std::string& aLogPath, const std::vector<IndexEntry>& someEntries, std::vector<Block>& someBlocksOut);
+
+	private:
+		bool OpenStreams();
+		//Cuts both files to the first aCount blocks
+		bool Resize(size_t aCount, uint64_t aLogSize);
+
+		std::vector<IndexEntry> mIndex;
+		std::ofstream mLog;
+		std::ofstream mIndexFile;
+		std::string mLogPath;
+		std::string mIndexPath;
+		uint64_t mLogSize{};
+	};
+}
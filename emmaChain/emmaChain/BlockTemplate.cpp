@@ -0,0 +1,112 @@
+#include "BlockTemplate.h"
+
+#include "Block.h"
+
+#include <utility>
+
+namespace emmaChain {
+	void BlockTemplate::SetTip(uint32_t aHeight, const CU::SHA256Digest& aPreviousDigest, uint32_t aTargetBits)
+	{
+		mHeight = aHeight;
+		mPreviousHash = aPreviousDigest;
+		mTargetBits = aTargetBits;
+	}
+
+	void BlockTemplate::AddTransaction(const Transaction& aTransaction)
+	{
+		AppendLeaf(Block::HashTransaction(aTransaction));
+	}
+
+	void BlockTemplate::RemoveFront(size_t aCount)
+	{
+		if (mLevels.empty())
+		{
+			return;
+		}
+		std::vector<CU::SHA256Digest> leaves = std::move(mLevels.front());
+		Clear();
+		for (size_t i = aCount; i < leaves.size(); i++)
+		{
+			AppendLeaf(leaves[i]);
+		}
+	}
+
+	void BlockTemplate::Clear()
+	{
+		mLevels.clear();
+	}
+
+	BlockHeader BlockTemplate::GetHeader(const Transaction& aReward, int64_t aTimestamp) const
+	{
+		//Walks the path the reward would take if it were appended, without touching the stored tree
+		CU::SHA256Digest node = Block::HashTransaction(aReward);
+		size_t index = mLevels.empty() ? 0 : mLevels.front().size();
+		for (size_t level = 0; index > 0; level++)
+		{
+			if (index % 2 != 0)
+			{
+				node = Block::HashPair(mLevels[level][index - 1], node);
+			}
+			index /= 2;
+		}
+
+		BlockHeader header;
+		header.mIndex = mHeight;
+		header.mTimestamp = aTimestamp;
+		header.mPreviousHash = mPreviousHash;
+		header.mTransactionsRoot = node;
+		header.mTargetBits = mTargetBits;
+		return header;
+	}
+
+	uint32_t BlockTemplate::GetHeight() const
+	{
+		return mHeight;
+	}
+
+	const CU::SHA256Digest& BlockTemplate::GetPreviousHash() const
+	{
+		return mPreviousHash;
+	}
+
+	uint32_t BlockTemplate::GetTargetBits() const
+	{
+		return mTargetBits;
+	}
+
+	size_t BlockTemplate::GetTransactionCount() const
+	{
+		return mLevels.empty() ? 0 : mLevels.front().size();
+	}
+
+	void BlockTemplate::AppendLeaf(const CU::SHA256Digest& aLeaf)
+	{
+		if (mLevels.empty())
+		{
+			mLevels.emplace_back();
+		}
+		mLevels.front().push_back(aLeaf);
+
+		//Only the parents on the right edge change, a parent that was its unpaired child moved up gets the real pair now
+		size_t index = mLevels.front().size() - 1;
+		for (size_t level = 0; mLevels[level].size() > 1; level++)
+		{
+			const auto& nodes = mLevels[level];
+			const CU::SHA256Digest parent = index % 2 == 0 ? nodes[index] : Block::HashPair(nodes[index - 1], nodes[index]);
+			index /= 2;
+			if (level + 1 == mLevels.size())
+			{
+				mLevels.emplace_back();
+			}
+			auto& parents = mLevels[level + 1];
+			if (index == parents.size())
+			{
+				parents.push_back(parent);
+			}
+			else
+			{
+				parents[index] = parent;
+			}
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "BlockHeader.h"
+#include "Transaction.h"
+
+#include <CommonUtilities/sha256/sha256.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace emmaChain {
+	//The header of the next block, kept up to date as transactions arrive and blocks are added.
+	//The transactions root is a Merkle tree whose levels are all stored, so adding a transaction rehashes
+	//one path and building a header with the reward on the end costs another, never the whole tree.
+	class BlockTemplate {
+	public:
+		//Moves to a new chain tip, the pending transactions stay
+		void SetTip(uint32_t aHeight, const CU::SHA256Digest& aPreviousDigest, uint32_t aTargetBits);
+		void AddTransaction(const Transaction& aTransaction);
+		//Drops the first aCount transactions, the ones a block just took, and rebuilds the tree from the rest
+		void RemoveFront(size_t aCount);
+		//Drops all transactions
+		void Clear();
+
+		//Header of a block with the pending transactions followed by aReward, the nonce is left at 0
+		BlockHeader GetHeader(const Transaction& aReward, int64_t aTimestamp) const;
+
+		uint32_t GetHeight() const;
+		const CU::SHA256Digest& GetPreviousHash() const;
+		uint32_t GetTargetBits() const;
+		size_t GetTransactionCount() const;
+
+	private:
+		void AppendLeaf(const CU::SHA256Digest& aLeaf);
+
+		//mLevels[0] holds the transaction hashes, the last level the root. The last node of an odd level moves up unpaired,
+		//as in Block::CalculateTransactionsRoot().
+		std::vector<std::vector<CU::SHA256Digest>> mLevels;
+		CU::SHA256Digest mPreviousHash{};
+		uint32_t mHeight{};
+		uint32_t mTargetBits{};
+	};
+}
@@ -2,208 +2,1006 @@
 
 #include "Server.h"
 
+#include <CommonUtilities/MemoryMappedFile.h>
 #include <CommonUtilities/sha256/sha256.h>
+#include <CommonUtilities/sha256/sha256_constexpr.h>
 #include <Poco/Net/HTTPResponse.h>
 #include <Poco/URI.h>
 #include <rapidjson/document.h>
 
+#include <algorithm>
+#include <cassert>
+#include <functional>
 #include <iostream>
-#include <sstream>
+#include <iterator>
+#include <thread>
+#include <utility>
 
 
 namespace emmaChain {
+	namespace {
+		//12 leading zero bits, the fixed difficulty of 3 hex zeros the chain used to have (0x000fffff followed by zeros)
+		constexpr uint32_t INITIAL_TARGET_BITS = 0x1f0fffff;
+		//Retargeting never makes blocks easier than 8 leading zero bits
+		constexpr uint32_t MAX_TARGET_BITS = 0x1fffffff;
+
+		//Every node starts from the same genesis block, so its header and hash are known at compile time
+		constexpr int64_t GENESIS_PROOF = 100;
+		constexpr int64_t GENESIS_TIMESTAMP = 1609459200;
+		constexpr CU::SHA256Digest GENESIS_PREVIOUS_HASH{};
+		//No previous hash and no transactions, both are all zeros
+		constexpr BlockHeader GENESIS_HEADER{ BlockHeader::VERSION, 0, GENESIS_TIMESTAMP, {}, {}, INITIAL_TARGET_BITS, GENESIS_PROOF };
+		constexpr CU::SHA256Digest GENESIS_DIGEST = CU::sha256Constexpr(GENESIS_HEADER.Serialize());
+
+		constexpr int64_t TARGET_BLOCK_SECONDS = 60;
+		//Every RETARGET_INTERVAL blocks the target is scaled by how long the last RETARGET_INTERVAL blocks actually took
+		constexpr size_t RETARGET_INTERVAL = 10;
+		//Bounds one retarget step, timestamps come from whoever mined the block
+		constexpr int64_t MAX_RETARGET_FACTOR = 4;
+		//A block has to be later than the median timestamp of this many blocks before it, so no block can pull a window back
+		constexpr size_t MEDIAN_TIME_BLOCKS = 11;
+		//and can be at most this far ahead of our clock, so forged timestamps can't stretch a window much either
+		constexpr int64_t MAX_FUTURE_SECONDS = 2 * RETARGET_INTERVAL * TARGET_BLOCK_SECONDS;
+
+		//Export records decoded and checked at a time, bounds the memory an import takes
+		constexpr size_t IMPORT_BATCH_BLOCKS = 4096;
+		//Stored bodies read between two turns at the chain lock while a node starts
+		constexpr size_t STORED_BODY_BATCH = 256;
+		//JSON blocks whose headers are hashed in one sha256Batch call, a few rounds of the widest batch
+		constexpr size_t JSON_HEADER_BATCH = 64;
+
+		bool TargetLess(const CU::SHA256Target& aLeft, const CU::SHA256Target& aRight)
+		{
+			return std::lexicographical_compare(std::begin(aLeft.words), std::end(aLeft.words), std::begin(aRight.words), std::end(aRight.words));
+		}
+
+		//Calls aFunction for every index below aCount, one contiguous range per hardware thread.
+		//An exception can't leave a thread, so one thrown by aFunction (e.g. std::bad_alloc) stops its range and makes this return false.
+		bool ParallelFor(size_t aCount, const std::function<void(size_t)>& aFunction)
+		{
+			const size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), std::max<size_t>(aCount, 1));
+			std::atomic<bool> failed{ false };
+			auto runRange = [&](size_t aThread)
+			{
+				try
+				{
+					for (size_t i = aCount * aThread / threadCount; i < aCount * (aThread + 1) / threadCount && !failed; i++)
+					{
+						aFunction(i);
+					}
+				}
+				catch (...)
+				{
+					failed = true;
+				}
+			};
+			std::vector<std::thread> threads;
+			for (size_t thread = 1; thread < threadCount; thread++)
+			{
+				threads.emplace_back(runRange, thread);
+			}
+			runRange(0);
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+			return !failed;
+		}
+
+		bool HasString(const rapidjson::Value& anObject, const char* aName)
+		{
+			return anObject.HasMember(aName) && anObject[aName].IsString();
+		}
+
+		//The JSON comes from peers and export files, every member is checked before it is read.
+		//False if one is missing or mistyped, or previous_hash is not a SHA-256 hex digest.
+		//The header isn't hashed here, BlocksFromJson() hashes a batch of them at once.
+		bool BlockFromJson(const rapidjson::Value& aBlock, BlockHeader& aHeaderOut, BlockBody& someTransactionsOut)
+		{
+			if (!aBlock.IsObject() || !aBlock.HasMember("index") || !aBlock["index"].IsUint() || !aBlock.HasMember("proof") || !aBlock["proof"].IsInt64()
+				|| !HasString(aBlock, "previous_hash") || !aBlock.HasMember("timestamp") || !aBlock["timestamp"].IsInt64()
+				|| !aBlock.HasMember("target") || !aBlock["target"].IsUint())
+			{
+				return false;
+			}
+			std::vector<Transaction> transactions;
+			if (aBlock.HasMember("transactions"))
+			{
+				if (!aBlock["transactions"].IsArray())
+				{
+					return false;
+				}
+				auto transactionsJson = aBlock["transactions"].GetArray();
+				for (const auto& transaction : transactionsJson)
+				{
+					if (!transaction.IsObject() || !HasString(transaction, "sender") || !HasString(transaction, "recipient") || !HasString(transaction, "message")
+						|| !transaction.HasMember("amount") || !transaction["amount"].IsUint())
+					{
+						return false;
+					}
+					transactions.push_back(Transaction{ transaction["sender"].GetString(),
+																		transaction["recipient"].GetString(),
+																		transaction["message"].GetString(),
+																		transaction["amount"].GetUint() });
+				}
+			}
+			if (!CU::sha256FromHex(aBlock["previous_hash"].GetString(), aHeaderOut.mPreviousHash))
+			{
+				return false;
+			}
+			someTransactionsOut = BlockBody(transactions);
+			aHeaderOut.mIndex = aBlock["index"].GetUint();
+			aHeaderOut.mTimestamp = aBlock["timestamp"].GetInt64();
+			aHeaderOut.mTransactionsRoot = Block::CalculateTransactionsRoot(someTransactionsOut);
+			aHeaderOut.mTargetBits = aBlock["target"].GetUint();
+			aHeaderOut.mNonce = static_cast<uint64_t>(aBlock["proof"].GetInt64());
+			return true;
+		}
+
+		//Decodes the blocks of aChain from aBegin up to anEnd into someBlocksOut, stopping at the first malformed one.
+		//Their headers are hashed with one sha256Batch call and the blocks built with those digests. Returns how many were decoded.
+		size_t BlocksFromJson(const rapidjson::Value& aChain, size_t aBegin, size_t anEnd, std::vector<std::optional<Block>>& someBlocksOut)
+		{
+			std::vector<BlockHeader> headers(anEnd - aBegin);
+			std::vector<BlockBody> bodies(anEnd - aBegin);
+			size_t count = 0;
+			while (count < headers.size() && BlockFromJson(aChain[static_cast<rapidjson::SizeType>(aBegin + count)], headers[count], bodies[count]))
+			{
+				count++;
+			}
+			if (count == 0)
+			{
+				return 0;
+			}
+
+			std::vector<BlockHeader::Bytes> bytes(count);
+			std::vector<const unsigned char*> messages(count);
+			std::vector<size_t> lengths(count, BlockHeader::SIZE);
+			for (size_t i = 0; i < count; i++)
+			{
+				bytes[i] = headers[i].Serialize();
+				messages[i] = bytes[i].data();
+			}
+			std::vector<CU::SHA256Digest> digests(count);
+			CU::sha256Batch(messages.data(), lengths.data(), count, digests.front().data());
+			for (size_t i = 0; i < count; i++)
+			{
+				someBlocksOut[aBegin + i].emplace(headers[i], std::move(bodies[i]), digests[i]);
+			}
+			return count;
+		}
+	}
+
 	Blockchain::Blockchain(Server& aServer)
 		: mServer(aServer)
 	{
-		mDifficulty = 3;
 		CreateGenesisBlock();
+		ResetNextBlock();
 		RegisterNode(mServer.GetMyHttpAdress());
 	}
 
+	Blockchain::~Blockchain()
+	{
+		mStopLoadingBodies = true;
+		WaitForStoredBodies();
+	}
+
 	std::vector<Block> Blockchain::ConstructChainFromJson(rapidjson::Document& aJsonDocument)
 	{
 		std::vector<Block> result;
-		auto chainJson = aJsonDocument["chain"].GetArray();
-		std::vector<Block> neighboursChain;
-		for (const auto& block : chainJson)
+		if (!aJsonDocument.IsObject() || !aJsonDocument.HasMember("chain") || !aJsonDocument["chain"].IsArray())
 		{
-			std::vector<Transaction> transactions;
-			if (block.HasMember("transactions") && block["transactions"].IsArray())
+			return result;
+		}
+		const auto& chainJson = aJsonDocument["chain"];
+		std::vector<std::optional<Block>> blocks(chainJson.Size());
+		for (size_t begin = 0; begin < blocks.size(); begin += JSON_HEADER_BATCH)
+		{
+			const size_t end = std::min(blocks.size(), begin + JSON_HEADER_BATCH);
+			if (BlocksFromJson(chainJson, begin, end, blocks) != end - begin)
 			{
-				auto transactionsJson = block["transactions"].GetArray();
-				for (const auto& transaction : transactionsJson)
-				{
-					transactions.push_back(Transaction{ transaction["sender"].GetString(),
-																		transaction["recipient"].GetString(),
-																		transaction["message"].GetString(),
-																		transaction["amount"].GetUint() });
-				}
+				return result;
 			}
-			result.push_back(Block(block["index"].GetUint(), block["proof"].GetInt64(), block["previous_hash"].GetString(),
-				transactions, block["timestamp"].GetInt64()));
 		}
 
+		result.reserve(blocks.size());
+		for (auto& block : blocks)
+		{
+			result.push_back(std::move(*block));
+		}
 		return result;
 	}
 
-	bool Blockchain::Mine(const std::string& aNodeIdentifier)
+	bool Blockchain::ConstructBlockFromJson(const std::string& aJson, std::optional<Block>& aBlockOut)
 	{
-		if (mPendingTransactions.empty())
+		rapidjson::Document document;
+		document.Parse(aJson.c_str(), aJson.size());
+		BlockHeader header;
+		BlockBody transactions;
+		if (document.HasParseError() || !BlockFromJson(document, header, transactions))
 		{
 			return false;
 		}
-
-		const auto& lastBlock = GetLastBlock();
-		int64_t lastProof = lastBlock.GetProof();
-		int64_t proof = ProofOfWork(lastProof);
-		NewTransaction("0", aNodeIdentifier, "Mining reward", 1);
-		std::string previousHash = Hash(lastBlock);
-		AddNewBlock(proof, previousHash);
+		const auto& bytes = header.Serialize();
+		CU::SHA256Digest digest;
+		CU::sha256Digest(bytes.data(), bytes.size(), digest.data());
+		aBlockOut.emplace(header, std::move(transactions), digest);
 		return true;
 	}
 
-	const Block& Blockchain::AddNewBlock(int64_t aProof, std::string aPreviousHash)
+	bool Blockchain::Mine(const std::string& aNodeIdentifier)
+	{
+		const std::atomic<bool> neverCancelled{ false };
+		std::optional<Block> minedBlock;
+		return Mine(aNodeIdentifier, neverCancelled, minedBlock) == MineResult::Mined;
+	}
+
+	MineResult Blockchain::Mine(const std::string& aNodeIdentifier, const std::atomic<bool>& aCancelled, std::optional<Block>& aMinedBlockOut)
+	{
+		BlockBody transactions;
+		size_t pendingCount = 0;
+		CU::SHA256Digest previousHash;
+		uint32_t height = 0;
+		uint32_t targetBits = 0;
+		BlockHeader header;
+		const Transaction reward{ "0", aNodeIdentifier, "Mining reward", 1 };
+		{
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			if (mPendingTransactions.empty())
+			{
+				return MineResult::NothingToMine;
+			}
+			//Blocks from a clock that runs ahead of ours can put the median past our time, the block would be rejected then
+			const int64_t timestamp = std::max<int64_t>(time(nullptr), MedianTimePast(mChain, mChain.size()) + 1);
+			//The template already has the transactions root of the pending transactions, the reward only adds one path to it
+			header = mNextBlock.GetHeader(reward, timestamp);
+			//One allocation for the whole body, the pending transactions are only dropped once the block is committed
+			transactions = BlockBody(mPendingTransactions, reward);
+			pendingCount = mPendingTransactions.size();
+			previousHash = mNextBlock.GetPreviousHash();
+			height = mNextBlock.GetHeight();
+			targetBits = mNextBlock.GetTargetBits();
+		}
+
+		MiningRun run;
+		const bool found = mMiner.FindProof(header, CU::sha256TargetFromCompact(targetBits), aCancelled, run);
+		mMiningStats.AddRun(height, run);
+		if (!found)
+		{
+			return MineResult::Cancelled;
+		}
+
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
+		//Transactions are only ever appended while mining, so the ones in the block are still the first pendingCount
+		if (mChain.size() != height || mNextBlock.GetPreviousHash() != previousHash || mPendingTransactions.size() < pendingCount)
+		{
+			return MineResult::Cancelled;
+		}
+		mPendingTransactions.erase(mPendingTransactions.begin(), mPendingTransactions.begin() + pendingCount);
+		mNextBlock.RemoveFront(pendingCount);
+		header.mNonce = static_cast<uint64_t>(run.mProof);
+		const auto& bytes = header.Serialize();
+		CU::SHA256Digest digest;
+		CU::sha256Digest(bytes.data(), bytes.size(), digest.data());
+		aMinedBlockOut = CommitBlock(Block(header, std::move(transactions), digest));
+		return MineResult::Mined;
+	}
+
+	const Block& Blockchain::CommitBlock(Block aBlock)
 	{
-		mChain.push_back(Block(static_cast<uint32_t>(mChain.size()), aProof, aPreviousHash, mPendingTransactions));
-		mPendingTransactions.clear();
-		return GetLastBlock();
+		if (mBlockStore.IsOpen() && !mBlockStore.Append(aBlock))
+		{
+			CloseBlockStore("append to");
+		}
+		mChain.push_back(std::move(aBlock));
+		mChain.back().InternAddresses(mAddresses);
+		mChainWork = CU::sha256TargetAdd(mChainWork, CU::sha256TargetWork(CU::sha256TargetFromCompact(mChain.back().GetTargetBits())));
+		const uint32_t height = static_cast<uint32_t>(mChain.size());
+		mBlockIndex.Insert(mChain.back().GetDigest(), height - 1);
+		mNextBlock.SetTip(height, mChain.back().GetDigest(), TargetBitsForHeight(mChain, height, mNextBlock.GetTargetBits()));
+		//Only the block that just left the kept window has a body to drop
+		const size_t firstKeptBody = GetFirstKeptBody(height);
+		if (firstKeptBody > 0)
+		{
+			mChain[firstKeptBody - 1].PruneBody();
+		}
+		CatchUpColumns();
+		return mChain.back();
+	}
+
+	void Blockchain::ResetNextBlock()
+	{
+		//Blocks the index still has at the same height were on the old chain too, their transactions are in the columns already
+		uint32_t keptHeight = 0;
+		uint32_t indexedHeight = 0;
+		while (keptHeight < mChain.size() && mBlockIndex.Find(mChain[keptHeight].GetDigest(), indexedHeight) && indexedHeight == keptHeight)
+		{
+			keptHeight++;
+		}
+		//Every block of the new chain passed validation, so its addresses can go into the table
+		for (auto& block : mChain)
+		{
+			block.InternAddresses(mAddresses);
+		}
+		mTransactionColumns.Truncate(keptHeight);
+		mColumnsEnd = std::min<size_t>(mColumnsEnd, keptHeight);
+		CatchUpColumns();
+
+		mBlockIndex.Clear();
+		for (size_t height = 0; height < mChain.size(); height++)
+		{
+			mBlockIndex.Insert(mChain[height].GetDigest(), static_cast<uint32_t>(height));
+		}
+		mNextBlock.SetTip(static_cast<uint32_t>(mChain.size()), mChain.back().GetDigest(), NextTargetBits(mChain));
+		mChainWork = ChainWork(mChain);
+	}
+
+	void Blockchain::CatchUpColumns()
+	{
+		//The columns only cover the kept bodies, which are all in memory, so nothing is read back from the block store
+		const size_t firstKeptBody = GetFirstKeptBody(mChain.size());
+		mTransactionColumns.DropBelow(static_cast<uint32_t>(firstKeptBody));
+		mColumnsEnd = std::max(mColumnsEnd, firstKeptBody);
+		while (mColumnsEnd < mChain.size() && mChain[mColumnsEnd].HasBody())
+		{
+			mTransactionColumns.Append(mChain[mColumnsEnd]);
+			mColumnsEnd++;
+		}
+	}
+
+	void Blockchain::LoadStoredBodies(std::vector<BlockStore::IndexEntry> someEntries, size_t aFirstHeight, std::string aLogPath)
+	{
+		for (size_t first = 0; first < someEntries.size() && !mStopLoadingBodies; first += STORED_BODY_BATCH)
+		{
+			const size_t end = std::min(first + STORED_BODY_BATCH, someEntries.size());
+			const std::vector<BlockStore::IndexEntry> batch(someEntries.begin() + first, someEntries.begin() + end);
+			std::vector<Block> bodies;
+			const bool intact = BlockStore::ReadRecords(aLogPath, batch, bodies);
+
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			//Blocks may have been added, pruned or replaced while the batch was read
+			const size_t firstKeptBody = GetFirstKeptBody(mChain.size());
+			for (size_t i = 0; i < bodies.size(); i++)
+			{
+				const size_t height = aFirstHeight + first + i;
+				if (height >= firstKeptBody && height < mChain.size() && !mChain[height].HasBody() && mChain[height].GetDigest() == bodies[i].GetDigest())
+				{
+					mChain[height] = std::move(bodies[i]);
+					mChain[height].InternAddresses(mAddresses);
+				}
+			}
+			CatchUpColumns();
+			if (intact)
+			{
+				continue;
+			}
+
+			//Like a record that is cut off, a damaged one ends the stored chain, blocks on top of it can't be served either
+			const size_t damagedHeight = aFirstHeight + first + bodies.size();
+			if (damagedHeight < mChain.size() && mChain[damagedHeight].GetDigest() == someEntries[damagedHeight - aFirstHeight].mDigest)
+			{
+				std::cout << "Block " << damagedHeight << " is damaged in the block store, the chain goes back to the block before it" << std::endl;
+				mChain.erase(mChain.begin() + damagedHeight, mChain.end());
+				if (!mBlockStore.Truncate(damagedHeight))
+				{
+					CloseBlockStore("truncate");
+				}
+				if (mChain.empty())
+				{
+					CreateGenesisBlock();
+					StoreChain();
+				}
+				ResetNextBlock();
+			}
+			return;
+		}
+	}
+
+	void Blockchain::WaitForStoredBodies()
+	{
+		if (mBodyLoader.joinable())
+		{
+			mBodyLoader.join();
+		}
+	}
+
+	void Blockchain::StoreChain()
+	{
+		if (!mBlockStore.IsOpen())
+		{
+			return;
+		}
+		//A replacement chain usually shares most of its blocks with the stored one, only the rest is rewritten
+		const size_t storedCount = std::min(mBlockStore.GetBlockCount(), mChain.size());
+		size_t commonCount = 0;
+		while (commonCount < storedCount && mChain[commonCount].GetDigest() == mBlockStore.GetDigest(commonCount))
+		{
+			commonCount++;
+		}
+		if (!mBlockStore.Truncate(commonCount))
+		{
+			CloseBlockStore("truncate");
+			return;
+		}
+		for (size_t i = commonCount; i < mChain.size(); i++)
+		{
+			//The transactions of a pruned block are gone, storing its header alone would break the log
+			if (!mChain[i].HasBody())
+			{
+				CloseBlockStore("store a pruned block in");
+				return;
+			}
+			if (!mBlockStore.Append(mChain[i]))
+			{
+				CloseBlockStore("append to");
+				return;
+			}
+		}
+	}
+
+	void Blockchain::PruneBodies()
+	{
+		const size_t firstKeptBody = GetFirstKeptBody(mChain.size());
+		for (size_t height = 0; height < firstKeptBody; height++)
+		{
+			mChain[height].PruneBody();
+		}
+		CatchUpColumns();
+	}
+
+	size_t Blockchain::GetFirstKeptBody(size_t aChainSize) const
+	{
+		return mKeptBodies == 0 || aChainSize <= mKeptBodies ? 0 : aChainSize - mKeptBodies;
+	}
+
+	void Blockchain::CloseBlockStore(const char* aFailedAction)
+	{
+		std::cout << "Can't " << aFailedAction << " the block store, blocks are only kept in memory from now on" << std::endl;
+		mBlockStore.Close();
 	}
 
 	int Blockchain::NewTransaction(const std::string& aSender, const std::string& aRecipient, const std::string& aMessage, uint32_t anAmount)
 	{
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
 		mPendingTransactions.push_back({ aSender, aRecipient, aMessage, anAmount });
-		return GetLastBlock().GetIndex() + 1;
+		mNextBlock.AddTransaction(mPendingTransactions.back());
+		return mChain.back().GetIndex() + 1;
 	}
 
 	std::string Blockchain::Hash(const Block& aBlock) const
 	{
-		return aBlock.CalculateHash();
+		return aBlock.GetHash();
+	}
+
+	int64_t Blockchain::ProofOfWork(const BlockHeader& aHeader)
+	{
+		const std::atomic<bool> neverCancelled{ false };
+		MiningRun run;
+		mMiner.FindProof(aHeader, CU::sha256TargetFromCompact(aHeader.mTargetBits), neverCancelled, run);
+		mMiningStats.AddRun(aHeader.mIndex, run);
+		return run.mProof;
+	}
+
+	void Blockchain::SetMiningThreadCount(unsigned int aThreadCount)
+	{
+		mMiner.SetThreadCount(aThreadCount);
+	}
+
+	bool Blockchain::OpenBlockStore(const std::string& aDirectory)
+	{
+		mStopLoadingBodies = true;
+		WaitForStoredBodies();
+		mStopLoadingBodies = false;
+
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
+		std::vector<Block> storedChain;
+		if (!mBlockStore.Open(aDirectory) || !mBlockStore.Load(storedChain))
+		{
+			mBlockStore.Close();
+			return false;
+		}
+		if (storedChain.empty())
+		{
+			StoreChain();
+			PruneBodies();
+			return mBlockStore.IsOpen();
+		}
+		//Blocks were checked before they were stored, only the genesis block is compared so another chain's files aren't picked up
+		if (mBlockStore.GetDigest(0) != GENESIS_DIGEST)
+		{
+			mBlockStore.Close();
+			return false;
+		}
+		if (storedChain.size() <= mChain.size())
+		{
+			StoreChain();
+			PruneBodies();
+			return mBlockStore.IsOpen();
+		}
+
+		mChain = std::move(storedChain);
+		ResetNextBlock();
+		//Only the bodies the chain keeps are read, the thread waits for the lock until we return
+		const size_t firstKeptBody = GetFirstKeptBody(mChain.size());
+		std::vector<BlockStore::IndexEntry> entries(mChain.size() - firstKeptBody);
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			mBlockStore.GetIndexEntry(firstKeptBody + i, entries[i]);
+		}
+		mBodyLoader = std::thread(&Blockchain::LoadStoredBodies, this, std::move(entries), firstKeptBody, mBlockStore.GetLogPath());
+		return true;
+	}
+
+	void Blockchain::SetKeptBodies(size_t aKeptBodies)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
+		mKeptBodies = aKeptBodies;
+		PruneBodies();
 	}
 
-	int64_t Blockchain::ProofOfWork(int64_t aLastProof)
+	bool Blockchain::UseMiningWorkers(const std::string& aQueueName)
 	{
-		int64_t proof = 0;
-		while (!ValidProof(aLastProof, proof))
+		if (!mMiningQueue.Create(aQueueName))
 		{
-			proof++;
+			return false;
 		}
-		return proof;
+		mMiner.SetQueue(&mMiningQueue);
+		return true;
 	}
 
 	void Blockchain::RegisterNode(const std::string& anAddress)
 	{
 		Poco::URI uri(anAddress);
 		std::string authority(uri.getAuthority());
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
 		mNodes.insert(authority);
 	}
 
 	bool Blockchain::ValidChain(const std::vector<Block>& aChain) const
 	{
-		const Block* lastBlock = &aChain.front();
-		size_t currentIndex = 1;
+		CU::SHA256Target work;
+		return ValidChain(aChain, work);
+	}
+
+	bool Blockchain::ValidChain(const std::vector<Block>& aChain, CU::SHA256Target& aWorkOut) const
+	{
+		//Only chains grown from our genesis block are accepted
+		if (aChain.empty() || aChain.front().GetDigest() != GENESIS_DIGEST)
+		{
+			return false;
+		}
 
-		while (currentIndex < aChain.size())
+		//Digests were computed when the blocks were built, so each link is a comparison and a target check
+		const int64_t now = time(nullptr);
+		uint32_t targetBits = INITIAL_TARGET_BITS;
+		for (size_t i = 1; i < aChain.size(); i++)
 		{
-			auto& block = aChain.at(currentIndex);
-			if (block.GetPreviousHash() != Hash(*lastBlock))
+			const auto& block = aChain[i];
+			targetBits = TargetBitsForHeight(aChain, i, targetBits);
+			if (block.GetIndex() != static_cast<int>(i) || block.GetPreviousHash() != aChain[i - 1].GetDigest() || !ValidProof(block, targetBits)
+				|| !ValidTimestamp(aChain, i, block.GetTimestamp(), now))
 			{
 				return false;
 			}
-			if (!ValidProof(lastBlock->GetProof(), block.GetProof()))
+		}
+
+		aWorkOut = ChainWork(aChain);
+		return true;
+	}
+
+	bool Blockchain::FindBlock(const std::string& aHash, std::optional<Block>& aBlockOut) const
+	{
+		CU::SHA256Digest digest;
+		if (!CU::sha256FromHex(aHash, digest))
+		{
+			return false;
+		}
+		std::vector<Block> blocks;
+		uint32_t height = 0;
+		{
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			if (!mBlockIndex.Find(digest, height))
+			{
+				return false;
+			}
+			blocks.push_back(mChain[height]);
+		}
+		ReadPrunedBodies(blocks, height);
+		aBlockOut = std::move(blocks.front());
+		return true;
+	}
+
+	bool Blockchain::GetBlockWithBody(size_t aHeight, std::optional<Block>& aBlockOut) const
+	{
+		std::vector<Block> blocks;
+		{
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			if (aHeight >= mChain.size())
+			{
+				return false;
+			}
+			blocks.push_back(mChain[aHeight]);
+		}
+		ReadPrunedBodies(blocks, aHeight);
+		if (!blocks.front().HasBody())
+		{
+			return false;
+		}
+		aBlockOut = std::move(blocks.front());
+		return true;
+	}
+
+	std::vector<Block> Blockchain::GetChainWithBodies() const
+	{
+		std::vector<Block> chain = GetChain();
+		ReadPrunedBodies(chain, 0);
+		return chain;
+	}
+
+	void Blockchain::ReadPrunedBodies(std::vector<Block>& someBlocks, size_t aFirstHeight) const
+	{
+		std::vector<size_t> positions;
+		std::vector<BlockStore::IndexEntry> entries;
+		std::string logPath;
+		{
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			if (!mBlockStore.IsOpen())
+			{
+				return;
+			}
+			logPath = mBlockStore.GetLogPath();
+			for (size_t i = 0; i < someBlocks.size(); i++)
+			{
+				//A record for another digest belongs to a chain that replaced the one someBlocks was copied from
+				BlockStore::IndexEntry entry;
+				if (!someBlocks[i].HasBody() && mBlockStore.GetIndexEntry(aFirstHeight + i, entry) && entry.mDigest == someBlocks[i].GetDigest())
+				{
+					positions.push_back(i);
+					entries.push_back(entry);
+				}
+			}
+		}
+		if (entries.empty())
+		{
+			return;
+		}
+
+		//The log is only appended to and every record is checked against its digest, so it is read without the lock
+		std::vector<Block> stored;
+		BlockStore::ReadRecords(logPath, entries, stored);
+		for (size_t i = 0; i < stored.size(); i++)
+		{
+			someBlocks[positions[i]] = std::move(stored[i]);
+		}
+	}
+
+	bool Blockchain::ImportChain(const std::string& aPath)
+	{
+		CU::MemoryMappedFile file;
+		if (!file.Open(aPath) || file.GetSize() == 0)
+		{
+			return false;
+		}
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
+		//A block log starts with a record magic, which can't start a JSON document
+		if (BlockStore::GetRecordSize(file.GetData(), file.GetSize(), 0) != 0)
+		{
+			return ImportBlockLog(file.GetData(), file.GetSize());
+		}
+		return ImportJson(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+	}
+
+	bool Blockchain::ImportBlockLog(const unsigned char* someBytes, size_t aSize)
+	{
+		size_t offset = 0;
+		size_t height = 0;
+		bool damaged = false;
+		std::vector<std::pair<size_t, size_t>> records;
+		std::vector<std::optional<Block>> blocks;
+		while (offset < aSize && !damaged)
+		{
+			//Finding the records is a walk over their sizes, everything else about them is checked in parallel
+			records.clear();
+			while (records.size() < IMPORT_BATCH_BLOCKS && offset < aSize)
+			{
+				const size_t recordSize = BlockStore::GetRecordSize(someBytes, aSize, offset);
+				if (recordSize == 0)
+				{
+					damaged = true;
+					break;
+				}
+				records.push_back({ offset, recordSize });
+				offset += recordSize;
+			}
+
+			blocks.assign(records.size(), std::nullopt);
+			const bool decoded = ParallelFor(records.size(), [&](size_t anIndex)
+			{
+				std::optional<Block>& block = blocks[anIndex];
+				//Blocks we have already are compared by digest, the others need a transactions root that matches and a proof of work
+				if (!BlockStore::DecodeUntrustedRecord(someBytes + records[anIndex].first, records[anIndex].second, block)
+					|| Block::CalculateTransactionsRoot(block->GetTransactions()) != block->GetHeader().mTransactionsRoot
+					|| (height + anIndex >= mChain.size() && !ValidProof(*block, block->GetTargetBits())))
+				{
+					block.reset();
+				}
+			});
+			if (!decoded)
+			{
+				return false;
+			}
+
+			for (auto& block : blocks)
+			{
+				if (!block || !AddImportedBlock(std::move(*block), height))
+				{
+					return false;
+				}
+				height++;
+			}
+		}
+		return !damaged;
+	}
+
+	bool Blockchain::ImportJson(const char* aJson, size_t aSize)
+	{
+		rapidjson::Document document;
+		document.Parse(aJson, aSize);
+		if (document.HasParseError() || !document.IsObject() || !document.HasMember("chain") || !document["chain"].IsArray())
+		{
+			return false;
+		}
+
+		//The whole document is parsed up front. Decoding the blocks and hashing their headers runs in parallel, a batch of headers per call.
+		//Blocks after a malformed one stay empty, so the import stops there.
+		const auto& chainJson = document["chain"];
+		std::vector<std::optional<Block>> blocks(chainJson.Size());
+		const size_t batchCount = (blocks.size() + JSON_HEADER_BATCH - 1) / JSON_HEADER_BATCH;
+		const bool decoded = ParallelFor(batchCount, [&](size_t aBatch)
+		{
+			const size_t begin = aBatch * JSON_HEADER_BATCH;
+			const size_t end = begin + BlocksFromJson(chainJson, begin, std::min(blocks.size(), begin + JSON_HEADER_BATCH), blocks);
+			for (size_t height = std::max(begin, mChain.size()); height < end; height++)
+			{
+				if (!ValidProof(*blocks[height], blocks[height]->GetTargetBits()))
+				{
+					blocks[height].reset();
+				}
+			}
+		});
+		if (!decoded)
+		{
+			return false;
+		}
+
+		for (size_t height = 0; height < blocks.size(); height++)
+		{
+			if (!blocks[height] || !AddImportedBlock(std::move(*blocks[height]), height))
 			{
 				return false;
 			}
-			lastBlock = &block;
-			currentIndex++;
 		}
+		return true;
+	}
 
+	bool Blockchain::AddImportedBlock(Block aBlock, size_t aHeight)
+	{
+		if (aBlock.GetIndex() != static_cast<int>(aHeight))
+		{
+			return false;
+		}
+		if (aHeight < mChain.size())
+		{
+			return aBlock.GetDigest() == mChain[aHeight].GetDigest();
+		}
+		//What AddBlock() checks, with the proof of work done already
+		if (aBlock.GetPreviousHash() != mNextBlock.GetPreviousHash() || aBlock.GetTargetBits() != mNextBlock.GetTargetBits()
+			|| !ValidTimestamp(mChain, aHeight, aBlock.GetTimestamp(), time(nullptr)))
+		{
+			return false;
+		}
+		CommitBlock(std::move(aBlock));
 		return true;
 	}
 
 	bool Blockchain::ResolveConflicts()
 	{
-		unsigned int maxLength = static_cast<unsigned int>(mChain.size());
+		//The neighbours are asked without the lock, mining and the HTTP threads go on meanwhile.
+		//The chain that took the most work wins, a longer chain of cheap blocks doesn't.
+		CU::SHA256Target maxWork;
+		{
+			std::lock_guard<std::recursive_mutex> lock(mMutex);
+			maxWork = mChainWork;
+		}
 		std::vector<Block> newChain;
 
-		for (auto& neighbour : mNodes)
+		for (const auto& neighbour : GetNodes())
 		{
 			const auto& response = mServer.HttpGet("http://" + neighbour + "/chain");
 			if (!response.empty())
 			{
 				rapidjson::Document jsonDocument;
 				jsonDocument.Parse(response.c_str());
-				unsigned int length = jsonDocument["length"].GetUint();
 				std::vector<Block> neighboursChain = ConstructChainFromJson(jsonDocument);
-				if (length > maxLength and ValidChain(neighboursChain))
+				CU::SHA256Target work;
+				if (ValidChain(neighboursChain, work) && TargetLess(maxWork, work))
 				{
-					maxLength = length;
-					newChain = neighboursChain;
+					maxWork = work;
+					newChain = std::move(neighboursChain);
 				}
 			}
 		}
-		if (!newChain.empty())
-		{
-			mChain = newChain;
-			return true;
-		}
-		return false;
+		//Our chain may have grown while the neighbours were asked
+		return !newChain.empty() && OverwriteLocalChain(newChain);
 	}
 
-	void Blockchain::OverwriteLocalChain(const std::vector<Block>& aNewChain)
+	bool Blockchain::OverwriteLocalChain(const std::vector<Block>& aNewChain)
 	{
+		const CU::SHA256Target work = ChainWork(aNewChain);
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
+		if (!TargetLess(mChainWork, work))
+		{
+			return false;
+		}
 		mChain = aNewChain;
+		ResetNextBlock();
+		StoreChain();
+		PruneBodies();
+		return true;
 	}
 
 	bool Blockchain::AddBlock(const Block& aNewBlock)
 	{
-		const auto& lastBlock = GetLastBlock();
-		const auto& previousHash = Hash(lastBlock);
-		if (aNewBlock.GetPreviousHash() != previousHash)
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
+		if (aNewBlock.GetPreviousHash() != mNextBlock.GetPreviousHash() || aNewBlock.GetIndex() != static_cast<int>(mChain.size()))
 		{
 			return false;
 		}
 
-		if (!ValidProof(lastBlock.GetProof(), aNewBlock.GetProof()))
+		if (!ValidProof(aNewBlock, mNextBlock.GetTargetBits()) || !ValidTimestamp(mChain, mChain.size(), aNewBlock.GetTimestamp(), time(nullptr)))
 		{
 			return false;
 		}
 
-		mChain.push_back(aNewBlock);
+		CommitBlock(aNewBlock);
 		return true;
 	}
 
-	const std::vector<Block>& Blockchain::GetChain() const
+	std::vector<Block> Blockchain::GetChain() const
 	{
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
 		return mChain;
 	}
 
 	void Blockchain::CreateGenesisBlock()
 	{
-		mChain.push_back(Block(0, 100, "1", std::vector<Transaction>()));
+		mChain.push_back(Block(0, GENESIS_PROOF, GENESIS_PREVIOUS_HASH, BlockBody(), GENESIS_TIMESTAMP, INITIAL_TARGET_BITS));
+		assert(mChain.front().GetHeader().Serialize() == GENESIS_HEADER.Serialize());
+		assert(mChain.front().GetDigest() == GENESIS_DIGEST);
 	}
 
-	const Block& Blockchain::GetLastBlock() const
+	Block Blockchain::GetLastBlock() const
 	{
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
 		return mChain.back();
 	}
 
-	const std::set<std::string>& Blockchain::GetNodes() const
+	std::set<std::string> Blockchain::GetNodes() const
 	{
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
 		return mNodes;
 	}
 
-	const std::vector<Transaction>& Blockchain::GetPendingTransactions() const
+	std::vector<Transaction> Blockchain::GetPendingTransactions() const
 	{
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
 		return mPendingTransactions;
 	}
 
-	bool Blockchain::ValidProof(int64_t aLastProof, int64_t aProof) const
+	bool Blockchain::HasPendingTransactions() const
 	{
-		std::string shoulStartWith;
-		shoulStartWith.resize(mDifficulty, '0');
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
+		return !mPendingTransactions.empty();
+	}
+
+	uint32_t Blockchain::GetNextIndex() const
+	{
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
+		return static_cast<uint32_t>(mChain.size());
+	}
 
-		std::string guess = std::to_string(aLastProof) + std::to_string(aProof);
-		std::string hash = CU::sha256(guess);
-		return hash.substr(0, mDifficulty) == shoulStartWith;
+	CU::SHA256Target Blockchain::GetTarget() const
+	{
+		return CU::sha256TargetFromCompact(GetTargetBits());
+	}
+
+	uint32_t Blockchain::GetTargetBits() const
+	{
+		std::lock_guard<std::recursive_mutex> lock(mMutex);
+		return mNextBlock.GetTargetBits();
+	}
+
+	const AddressTable& Blockchain::GetAddresses() const
+	{
+		return *mAddresses;
+	}
+
+	const TransactionColumns& Blockchain::GetTransactionColumns() const
+	{
+		return mTransactionColumns;
+	}
+
+	const MiningStats& Blockchain::GetMiningStats() const
+	{
+		return mMiningStats;
+	}
+
+	bool Blockchain::ValidProof(const Block& aBlock, uint32_t aTargetBits)
+	{
+		return aBlock.GetTargetBits() == aTargetBits && CU::sha256DigestMeetsTarget(aBlock.GetDigest().data(), CU::sha256TargetFromCompact(aTargetBits));
+	}
+
+	uint32_t Blockchain::TargetBitsForHeight(const std::vector<Block>& aChain, size_t aHeight, uint32_t aPreviousTargetBits)
+	{
+		//The genesis block is left out of the window, its timestamp is fixed and long gone
+		if (aHeight <= 1)
+		{
+			return INITIAL_TARGET_BITS;
+		}
+		if (aHeight % RETARGET_INTERVAL != 0 || aHeight <= RETARGET_INTERVAL)
+		{
+			return aPreviousTargetBits;
+		}
+
+		const int64_t expected = static_cast<int64_t>(RETARGET_INTERVAL - 1) * TARGET_BLOCK_SECONDS;
+		const int64_t actual = std::clamp<int64_t>(aChain[aHeight - 1].GetTimestamp() - aChain[aHeight - RETARGET_INTERVAL].GetTimestamp(),
+			expected / MAX_RETARGET_FACTOR, expected * MAX_RETARGET_FACTOR);
+		//Blocks came faster than expected -> smaller target -> harder proofs, and the other way round
+		const CU::SHA256Target target = CU::sha256TargetScale(CU::sha256TargetFromCompact(aPreviousTargetBits), static_cast<uint32_t>(actual), static_cast<uint32_t>(expected));
+		//Rounding down to the compact form only ever makes the target harder
+		return TargetLess(CU::sha256TargetFromCompact(MAX_TARGET_BITS), target) ? MAX_TARGET_BITS : CU::sha256TargetToCompact(target);
+	}
+
+	int64_t Blockchain::MedianTimePast(const std::vector<Block>& aChain, size_t aHeight)
+	{
+		int64_t timestamps[MEDIAN_TIME_BLOCKS];
+		const size_t count = std::min(aHeight, MEDIAN_TIME_BLOCKS);
+		for (size_t i = 0; i < count; i++)
+		{
+			timestamps[i] = aChain[aHeight - 1 - i].GetTimestamp();
+		}
+		std::nth_element(timestamps, timestamps + count / 2, timestamps + count);
+		return timestamps[count / 2];
+	}
+
+	bool Blockchain::ValidTimestamp(const std::vector<Block>& aChain, size_t aHeight, int64_t aTimestamp, int64_t aNow)
+	{
+		return aTimestamp > MedianTimePast(aChain, aHeight) && aTimestamp <= aNow + MAX_FUTURE_SECONDS;
+	}
+
+	CU::SHA256Target Blockchain::ChainWork(const std::vector<Block>& aChain)
+	{
+		//The target only changes every RETARGET_INTERVAL blocks, so the division runs about that rarely
+		CU::SHA256Target work{};
+		CU::SHA256Target blockWork{};
+		for (size_t height = 0; height < aChain.size(); height++)
+		{
+			if (height == 0 || aChain[height].GetTargetBits() != aChain[height - 1].GetTargetBits())
+			{
+				blockWork = CU::sha256TargetWork(CU::sha256TargetFromCompact(aChain[height].GetTargetBits()));
+			}
+			work = CU::sha256TargetAdd(work, blockWork);
+		}
+		return work;
+	}
+
+	uint32_t Blockchain::NextTargetBits(const std::vector<Block>& aChain)
+	{
+		uint32_t targetBits = INITIAL_TARGET_BITS;
+		for (size_t height = 1; height <= aChain.size(); height++)
+		{
+			targetBits = TargetBitsForHeight(aChain, height, targetBits);
+		}
+		return targetBits;
 	}
 }
\ No newline at end of file
@@ -1,44 +1,174 @@
 #pragma once
+#include "AddressTable.h"
 #include "Block.h"
+#include "BlockIndex.h"
+#include "BlockStore.h"
+#include "BlockTemplate.h"
+#include "Miner.h"
+#include "MiningQueue.h"
+#include "TransactionColumns.h"
 
+#include <CommonUtilities/sha256/sha256.h>
 #include <rapidjson/document.h>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
+#include <thread>
 
 
 namespace emmaChain {
 	class Server;
 
+	enum class MineResult
+	{
+		Mined,
+		NothingToMine,
+		//Stopped through the flag, or another block took the height before ours was committed
+		Cancelled
+	};
+
 	class Blockchain {
 	public:
 		Blockchain(Server& aServer);
+		~Blockchain();
 
+		//The blocks of a /chain response, empty if the document or any block in it is malformed
 		static std::vector<Block> ConstructChainFromJson(rapidjson::Document& aJsonDocument);
+		//A block sent to /block/add, checked like the blocks of ConstructChainFromJson(). False if aJson is malformed.
+		static bool ConstructBlockFromJson(const std::string& aJson, std::optional<Block>& aBlockOut);
 
 		bool Mine(const std::string& aNodeIdentifier);
-		const Block& AddNewBlock(int64_t aProof, std::string aPreviousHash);
+		//The proof of work runs without holding the chain lock, so blocks can be added meanwhile
+		MineResult Mine(const std::string& aNodeIdentifier, const std::atomic<bool>& aCancelled, std::optional<Block>& aMinedBlockOut);
 		int NewTransaction(const std::string& aSender, const std::string& aRecipient, const std::string& aMessage, uint32_t anAmount);
 		std::string Hash(const Block& aBlock) const;
-		int64_t ProofOfWork(int64_t aLastProof);
+		//Nonce that makes the hash of aHeader meet its own target bits
+		int64_t ProofOfWork(const BlockHeader& aHeader);
+		//0 uses every hardware thread, 1 gives the same proofs on every run
+		void SetMiningThreadCount(unsigned int aThreadCount);
+		//Publishes the blocks to mine under aQueueName for worker processes (see RunMiningWorker) instead of mining on local threads.
+		//Workers still attached from an earlier run of the node are taken over. Searches fall back to local threads while no worker runs.
+		//Call before mining starts, false if the shared memory can't be created.
+		bool UseMiningWorkers(const std::string& aQueueName);
+		//Continues from the blocks stored in aDirectory and stores every block added from now on.
+		//Only the headers are read here, the bodies of the kept window follow on a background thread.
+		//Call before the node serves requests, false if the files can't be used.
+		bool OpenBlockStore(const std::string& aDirectory);
+		//Waits until the background thread of OpenBlockStore() is done. Until then the transaction columns stop at the
+		//first block whose body is still on its way, and a damaged body cuts the chain back to the block before it.
+		void WaitForStoredBodies();
+		//Keeps the transactions of only the last aKeptBodies blocks in memory, every header stays. 0 keeps all of them.
+		//Pruned bodies are read back from the block store when they are served, without one they are gone.
+		//The transaction columns drop them as well, so their memory is bounded by the window too. Call before OpenBlockStore().
+		void SetKeptBodies(size_t aKeptBodies);
+		//Extends the chain from an export file, a copy of another node's blocks.log or a saved /chain response.
+		//Blocks are decoded and their proof of work checked on every core, then linked, indexed and stored batch by batch.
+		//Blocks we have already are skipped. False at the first block that is damaged, invalid or forks from our chain,
+		//the blocks before it stay. Call before the node serves requests and after OpenBlockStore() to store the imported blocks.
+		bool ImportChain(const std::string& aPath);
 		void RegisterNode(const std::string& anAddress);
+		//Links, proofs and targets of every block, and timestamps later than the median before them and not too far in the future
 		bool ValidChain(const std::vector<Block>& aChain) const;
+		//Also sums what the chain took to mine, see ChainWork()
+		bool ValidChain(const std::vector<Block>& aChain, CU::SHA256Target& aWorkOut) const;
+		//Looks the hex hash up in the hash index, false if no block on our chain has it
+		bool FindBlock(const std::string& aHash, std::optional<Block>& aBlockOut) const;
+		//The block at aHeight with its transactions, false if they were pruned and can't be read back
+		bool GetBlockWithBody(size_t aHeight, std::optional<Block>& aBlockOut) const;
+		//GetChain() with the pruned bodies read back in one pass over the block store, without holding the chain lock.
+		//Blocks whose bodies can't be read stay pruned.
+		std::vector<Block> GetChainWithBodies() const;
+		//Takes the valid neighbour chain with the most work, if that is more than ours
 		bool ResolveConflicts();
-		void OverwriteLocalChain(const std::vector<Block>& aNewChain);
+		//Replaces our chain with aNewChain if it took more work, aNewChain has to be valid (see ValidChain())
+		bool OverwriteLocalChain(const std::vector<Block>& aNewChain);
 		bool AddBlock(const Block& aNewBlock);
 
-		const std::vector<Block>& GetChain() const;
-		const Block& GetLastBlock() const;
-		const std::set<std::string>& GetNodes() const;
-		const std::vector<Transaction>& GetPendingTransactions() const;
+		//Copies taken under the lock, so they stay valid while background jobs add blocks or replace the chain
+		std::vector<Block> GetChain() const;
+		Block GetLastBlock() const;
+		std::set<std::string> GetNodes() const;
+		std::vector<Transaction> GetPendingTransactions() const;
+		bool HasPendingTransactions() const;
+		//Index the next block will get, i.e. the height a mining job works on
+		uint32_t GetNextIndex() const;
+		//Target the block at GetNextIndex() has to meet, and the compact form its header carries
+		CU::SHA256Target GetTarget() const;
+		uint32_t GetTargetBits() const;
+		const MiningStats& GetMiningStats() const;
+		//Addresses of the committed blocks, the ids GetTransactionColumns() uses. Safe to query without the chain lock.
+		const AddressTable& GetAddresses() const;
+		//Confirmed transactions of the blocks with kept bodies by column, safe to query without the chain lock
+		const TransactionColumns& GetTransactionColumns() const;
 
 	private:
 		void CreateGenesisBlock();
-		bool ValidProof(int64_t aLastProof, int64_t aProof) const;
+		//Appends a checked block, indexes it and moves mNextBlock on top of it, the caller holds mMutex
+		const Block& CommitBlock(Block aBlock);
+		//Reindexes a chain that was replaced as a whole and points mNextBlock at its end
+		void ResetNextBlock();
+		//Appends the blocks from mColumnsEnd on to the columns, up to the first one still waiting for its body
+		void CatchUpColumns();
+		//Runs on mBodyLoader, reads the bodies of someEntries (our blocks from aFirstHeight on) in batches without the lock
+		void LoadStoredBodies(std::vector<BlockStore::IndexEntry> someEntries, size_t aFirstHeight, std::string aLogPath);
+		//Brings the block store in line with a replaced mChain
+		void StoreChain();
+		//Reads the pruned bodies of someBlocks, copies of our blocks from aFirstHeight on, back from the block store.
+		//mMutex is only held to look the records up.
+		void ReadPrunedBodies(std::vector<Block>& someBlocks, size_t aFirstHeight) const;
+		//Drops the bodies of every block before GetFirstKeptBody(), for a chain that was replaced as a whole
+		void PruneBodies();
+		//Height of the oldest block of a chain of aChainSize blocks that keeps its transactions
+		size_t GetFirstKeptBody(size_t aChainSize) const;
+		//Mining goes on in memory when the disk fails
+		void CloseBlockStore(const char* aFailedAction);
+		bool ImportBlockLog(const unsigned char* someBytes, size_t aSize);
+		bool ImportJson(const char* aJson, size_t aSize);
+		//Commits a block whose proof of work is checked already, below mChain.size() it only has to be the block we have
+		bool AddImportedBlock(Block aBlock, size_t aHeight);
+		//The block has to carry aTargetBits and its header hash has to meet them
+		static bool ValidProof(const Block& aBlock, uint32_t aTargetBits);
+		//Target in force at aHeight given the one at aHeight - 1, only the timestamps of aChain below aHeight are used
+		static uint32_t TargetBitsForHeight(const std::vector<Block>& aChain, size_t aHeight, uint32_t aPreviousTargetBits);
+		//Target for the block after the last one in aChain, walks the whole chain
+		static uint32_t NextTargetBits(const std::vector<Block>& aChain);
+		//Median timestamp of the last MEDIAN_TIME_BLOCKS blocks below aHeight
+		static int64_t MedianTimePast(const std::vector<Block>& aChain, size_t aHeight);
+		//A block at aHeight has to be later than MedianTimePast() and at most MAX_FUTURE_SECONDS after aNow
+		static bool ValidTimestamp(const std::vector<Block>& aChain, size_t aHeight, int64_t aTimestamp, int64_t aNow);
+		//Sum of CU::sha256TargetWork() over the targets of every block, what fork choice compares
+		static CU::SHA256Target ChainWork(const std::vector<Block>& aChain);
 
-		uint32_t mDifficulty;
+		//Tip, target and transactions root of the block after mChain, kept in step with mChain and mPendingTransactions
+		BlockTemplate mNextBlock;
+		BlockStore mBlockStore;
+		//Digest to height for every block of mChain
+		BlockIndex mBlockIndex;
+		//Filled by CommitBlock() and ResetNextBlock(), blocks in mChain hold on to it too
+		std::shared_ptr<AddressTable> mAddresses{ std::make_shared<AddressTable>() };
+		//The transactions of the kept bodies, kept in step with mChain by CatchUpColumns()
+		TransactionColumns mTransactionColumns;
+		//Height of the first block that is not in the columns yet
+		size_t mColumnsEnd{};
+		//Declared before mMiner, which may point at it
+		MiningQueue mMiningQueue;
+		Miner mMiner;
+		MiningStats mMiningStats;
+		//Headers and hashes of every block, transactions only from GetFirstKeptBody() on
 		std::vector<Block> mChain;
+		//ChainWork() of mChain, kept in step by CommitBlock() and ResetNextBlock()
+		CU::SHA256Target mChainWork{};
+		size_t mKeptBodies{};
 		std::vector<Transaction> mPendingTransactions;
 		std::set<std::string> mNodes;
 		Server& mServer;
+		std::thread mBodyLoader;
+		std::atomic<bool> mStopLoadingBodies{ false };
+		//Guards the chain, its index and store, the pending transactions and mNodes against the HTTP threads and background jobs.
+		//mAddresses, mTransactionColumns, mMiningStats and mMiner have locks of their own.
+		mutable std::recursive_mutex mMutex;
 	};
 }
\ No newline at end of file
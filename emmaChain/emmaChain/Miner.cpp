@@ -0,0 +1,290 @@
+#include "Miner.h"
+
+#include "MiningQueue.h"
+
+#include <CommonUtilities/StopWatch.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace emmaChain {
+	namespace {
+		//Proofs claimed at a time from the shared counter, big enough that workers rarely touch it
+		constexpr int64_t CHUNK_SIZE = 1 << 16;
+		//How often a search through the queue looks for results and for cancellation
+		constexpr std::chrono::milliseconds QUEUE_POLL_INTERVAL{ 1 };
+		//Workers beat every few milliseconds even while idle, a queue quiet for this long has none attached
+		constexpr std::chrono::milliseconds QUEUE_WORKER_TIMEOUT{ 2000 };
+
+		struct ProofRange
+		{
+			std::mutex mMutex;
+			int64_t mNext{};
+			int64_t mEnd{};
+		};
+
+		struct Search
+		{
+			Search(const BlockHeader& aHeader, const CU::SHA256Target& aTarget, const std::atomic<bool>& aCancelled, unsigned int aWorkerCount)
+				: mTarget(aTarget)
+				, mCancelled(aCancelled)
+				, mRanges(aWorkerCount)
+				, mAttempts(aWorkerCount)
+				, mSeconds(aWorkerCount)
+			{
+				//Everything up to the nonce is the same for every attempt, so it is absorbed once and each batch resumes from there
+				const auto& bytes = aHeader.Serialize();
+				mHeaderContext.update(bytes.data(), BlockHeader::NONCE_OFFSET);
+			}
+
+			//Next batch of at most aCount proofs from aWorker's own range, false once it is empty
+			bool TakeBatch(unsigned int aWorker, size_t aCount, int64_t& aBegin, int64_t& anEnd)
+			{
+				auto& range = mRanges[aWorker];
+				std::lock_guard<std::mutex> lock(range.mMutex);
+				if (range.mNext >= range.mEnd)
+				{
+					return false;
+				}
+				aBegin = range.mNext;
+				anEnd = std::min(range.mNext + static_cast<int64_t>(aCount), range.mEnd);
+				range.mNext = anEnd;
+				return true;
+			}
+
+			//Moves the back half of the largest other range to aWorker, or a fresh chunk if no range is worth splitting
+			void Refill(unsigned int aWorker, size_t aMinSteal)
+			{
+				unsigned int victim = aWorker;
+				int64_t victimRemaining = 0;
+				for (unsigned int i = 0; i < mRanges.size(); i++)
+				{
+					std::lock_guard<std::mutex> lock(mRanges[i].mMutex);
+					const int64_t remaining = mRanges[i].mEnd - mRanges[i].mNext;
+					if (i != aWorker && remaining > victimRemaining)
+					{
+						victim = i;
+						victimRemaining = remaining;
+					}
+				}
+
+				int64_t begin = 0;
+				int64_t end = 0;
+				if (victim != aWorker)
+				{
+					//The victim kept working since the scan, so its range is measured again
+					auto& range = mRanges[victim];
+					std::lock_guard<std::mutex> lock(range.mMutex);
+					const int64_t half = (range.mEnd - range.mNext) / 2;
+					if (half >= static_cast<int64_t>(aMinSteal))
+					{
+						begin = range.mEnd - half;
+						end = range.mEnd;
+						range.mEnd = begin;
+					}
+				}
+				if (end == begin)
+				{
+					begin = mNextChunk.fetch_add(CHUNK_SIZE);
+					end = begin + CHUNK_SIZE;
+				}
+
+				auto& own = mRanges[aWorker];
+				std::lock_guard<std::mutex> lock(own.mMutex);
+				own.mNext = begin;
+				own.mEnd = end;
+			}
+
+			void Found(int64_t aProof)
+			{
+				//Two workers can hit at the same time, the lower proof is kept
+				int64_t current = mProof.load();
+				while (aProof < current && !mProof.compare_exchange_weak(current, aProof))
+				{
+				}
+				mFound.store(true);
+			}
+
+			void Work(unsigned int aWorker)
+			{
+				NonceBatch batch;
+
+				CU::StopWatch stopWatch;
+				stopWatch.Start();
+				uint64_t attempts = 0;
+				while (!mFound.load(std::memory_order_relaxed) && !mCancelled.load(std::memory_order_relaxed))
+				{
+					int64_t begin = 0;
+					int64_t end = 0;
+					if (!TakeBatch(aWorker, batch.mLanes, begin, end))
+					{
+						Refill(aWorker, batch.mLanes);
+						continue;
+					}
+
+					const size_t count = static_cast<size_t>(end - begin);
+					const size_t found = batch.Find(mHeaderContext, static_cast<uint64_t>(begin), count, mTarget);
+					attempts += count;
+					if (found < count)
+					{
+						Found(begin + static_cast<int64_t>(found));
+					}
+				}
+				stopWatch.Stop();
+				mAttempts[aWorker] = attempts;
+				mSeconds[aWorker] = stopWatch.GetTime();
+			}
+
+			CU::SHA256 mHeaderContext;
+			const CU::SHA256Target& mTarget;
+			const std::atomic<bool>& mCancelled;
+			std::vector<ProofRange> mRanges;
+			//Per worker, each written only by its own worker
+			std::vector<uint64_t> mAttempts;
+			std::vector<float> mSeconds;
+			std::atomic<int64_t> mNextChunk{ 0 };
+			std::atomic<int64_t> mProof{ std::numeric_limits<int64_t>::max() };
+			std::atomic<bool> mFound{ false };
+		};
+	}
+
+	Miner::Miner(unsigned int aThreadCount)
+	{
+		SetThreadCount(aThreadCount);
+	}
+
+	int64_t Miner::FindProof(const BlockHeader& aHeader, const CU::SHA256Target& aTarget) const
+	{
+		const std::atomic<bool> neverCancelled{ false };
+		MiningRun run;
+		FindProof(aHeader, aTarget, neverCancelled, run);
+		return run.mProof;
+	}
+
+	bool Miner::FindProof(const BlockHeader& aHeader, const CU::SHA256Target& aTarget, const std::atomic<bool>& aCancelled, MiningRun& aRunOut) const
+	{
+		if (FindProofThroughQueue(aHeader, aTarget, aCancelled, aRunOut))
+		{
+			return aRunOut.mFound;
+		}
+		return FindProofLocally(aHeader, aTarget, aCancelled, aRunOut);
+	}
+
+	bool Miner::FindProofLocally(const BlockHeader& aHeader, const CU::SHA256Target& aTarget, const std::atomic<bool>& aCancelled, MiningRun& aRunOut) const
+	{
+		CU::StopWatch stopWatch;
+		stopWatch.Start();
+		Search search(aHeader, aTarget, aCancelled, mThreadCount);
+		if (mThreadCount == 1)
+		{
+			//No threads at all, chunks are claimed in order so the result is the same as a plain nonce++ loop
+			search.Work(0);
+		}
+		else
+		{
+			std::vector<std::thread> workers;
+			workers.reserve(mThreadCount);
+			for (unsigned int i = 0; i < mThreadCount; i++)
+			{
+				workers.emplace_back([&search, i]() { search.Work(i); });
+			}
+			for (auto& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		stopWatch.Stop();
+
+		aRunOut.mFound = search.mFound.load();
+		aRunOut.mProof = aRunOut.mFound ? search.mProof.load() : 0;
+		aRunOut.mSeconds = stopWatch.GetTime();
+		aRunOut.mThreadAttempts = search.mAttempts;
+		aRunOut.mThreadSeconds = search.mSeconds;
+		return aRunOut.mFound;
+	}
+
+	void Miner::SetThreadCount(unsigned int aThreadCount)
+	{
+		mThreadCount = aThreadCount != 0 ? aThreadCount : std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	unsigned int Miner::GetThreadCount() const
+	{
+		return mThreadCount;
+	}
+
+	void Miner::SetQueue(MiningQueue* aQueue)
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		mQueue = aQueue;
+	}
+
+	bool Miner::FindProofThroughQueue(const BlockHeader& aHeader, const CU::SHA256Target& aTarget, const std::atomic<bool>& aCancelled, MiningRun& aRunOut) const
+	{
+		//A search for a stale height may still hold the queue, it gets cancelled soon after a new block arrives
+		std::unique_lock<std::mutex> lock(mQueueMutex, std::defer_lock);
+		while (!lock.try_lock())
+		{
+			if (aCancelled.load(std::memory_order_relaxed))
+			{
+				aRunOut = MiningRun();
+				return true;
+			}
+			std::this_thread::sleep_for(QUEUE_POLL_INTERVAL);
+		}
+		//SetQueue() changes the queue under the same lock
+		if (!mQueue)
+		{
+			return false;
+		}
+
+		CU::StopWatch stopWatch;
+		stopWatch.Start();
+		const uint64_t generation = mQueue->Publish(aHeader);
+		BlockHeader::Bytes candidate = aHeader.Serialize();
+		bool found = false;
+		uint64_t nonce = 0;
+		uint64_t heartbeat = mQueue->GetHeartbeat();
+		auto lastBeat = std::chrono::steady_clock::now();
+		while (!found && !aCancelled.load(std::memory_order_relaxed))
+		{
+			if (!mQueue->PollResult(generation, nonce))
+			{
+				const auto now = std::chrono::steady_clock::now();
+				const uint64_t beat = mQueue->GetHeartbeat();
+				if (beat != heartbeat)
+				{
+					heartbeat = beat;
+					lastBeat = now;
+				}
+				else if (now - lastBeat > QUEUE_WORKER_TIMEOUT)
+				{
+					mQueue->Withdraw();
+					return false;
+				}
+				std::this_thread::sleep_for(QUEUE_POLL_INTERVAL);
+				continue;
+			}
+			//Workers are other processes, their nonces are checked before anything is built on them
+			BlockHeader::WriteNonce(nonce, &candidate[BlockHeader::NONCE_OFFSET]);
+			found = CU::sha256MeetsTarget(candidate.data(), candidate.size(), aTarget);
+		}
+		const uint64_t attempts = mQueue->GetAttempts();
+		mQueue->Withdraw();
+		stopWatch.Stop();
+
+		//The workers report one total, so the run looks like a single thread
+		aRunOut.mFound = found;
+		aRunOut.mProof = found ? static_cast<int64_t>(nonce) : 0;
+		aRunOut.mSeconds = stopWatch.GetTime();
+		aRunOut.mThreadAttempts.assign(1, attempts);
+		aRunOut.mThreadSeconds.assign(1, aRunOut.mSeconds);
+		return true;
+	}
+}
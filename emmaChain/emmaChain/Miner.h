@@ -0,0 +1,46 @@
+#pragma once
+#include "BlockHeader.h"
+#include "MiningStats.h"
+
+#include <CommonUtilities/sha256/sha256.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace emmaChain {
+	class MiningQueue;
+
+	//Searches header nonces on several threads. Each worker walks its own range of nonces,
+	//idle workers steal half of the largest range left and only claim fresh proofs when there is nothing to steal.
+	class Miner {
+	public:
+		//0 threads means one per hardware thread
+		Miner(unsigned int aThreadCount = 0);
+
+		//Nonce for aHeader whose header hash meets aTarget, the nonce already in aHeader is ignored.
+		//With one thread this is the lowest valid nonce, with more it is the first one any worker finds.
+		int64_t FindProof(const BlockHeader& aHeader, const CU::SHA256Target& aTarget) const;
+		//Gives up and returns false once aCancelled is set, the workers poll it between batches.
+		//aRunOut gets the nonce and the attempts and time of every worker either way.
+		bool FindProof(const BlockHeader& aHeader, const CU::SHA256Target& aTarget, const std::atomic<bool>& aCancelled, MiningRun& aRunOut) const;
+
+		void SetThreadCount(unsigned int aThreadCount);
+		unsigned int GetThreadCount() const;
+		//Hands the search to worker processes attached to aQueue instead of local threads, nullptr mines locally again.
+		//A search falls back to local threads if no worker shows signs of life for QUEUE_WORKER_TIMEOUT.
+		//Set it before mining starts, the queue has to be created by the caller and outlive the Miner.
+		void SetQueue(MiningQueue* aQueue);
+
+	private:
+		bool FindProofLocally(const BlockHeader& aHeader, const CU::SHA256Target& aTarget, const std::atomic<bool>& aCancelled, MiningRun& aRunOut) const;
+		//False if no queue is set or no worker is attached, aRunOut is left alone then. Otherwise the search ran and aRunOut.mFound tells how it ended.
+		bool FindProofThroughQueue(const BlockHeader& aHeader, const CU::SHA256Target& aTarget, const std::atomic<bool>& aCancelled, MiningRun& aRunOut) const;
+
+		unsigned int mThreadCount{};
+		//Guarded by mQueueMutex
+		MiningQueue* mQueue{};
+		//The queue holds a single template, so only one search at a time can use it
+		mutable std::mutex mQueueMutex;
+	};
+}
@@ -0,0 +1,154 @@
+#include "MiningJobs.h"
+
+namespace emmaChain {
+	namespace {
+		//Finished jobs are kept around this long (in job count) so clients can still fetch their result
+		constexpr size_t MAX_FINISHED_JOBS = 64;
+	}
+
+	MiningJobs::~MiningJobs()
+	{
+		StopAll();
+	}
+
+	void MiningJobs::StopAll()
+	{
+		std::map<uint64_t, std::shared_ptr<Job>> jobs;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			for (auto& job : mJobs)
+			{
+				job.second->mCancelled.store(true);
+			}
+			jobs.swap(mJobs);
+		}
+		for (auto& job : jobs)
+		{
+			if (job.second->mThread.joinable())
+			{
+				job.second->mThread.join();
+			}
+		}
+	}
+
+	uint64_t MiningJobs::Start(Blockchain& aBlockchain, const std::string& aNodeIdentifier, MinedCallback aOnMined)
+	{
+		const uint32_t height = aBlockchain.GetNextIndex();
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (const auto& job : mJobs)
+		{
+			if (job.second->mInfo.mStatus == MiningJobStatus::Running && job.second->mInfo.mHeight == height)
+			{
+				return job.first;
+			}
+		}
+
+		RemoveOldJobs();
+		const uint64_t id = mNextId++;
+		auto job = std::make_shared<Job>();
+		job->mInfo.mId = id;
+		job->mInfo.mHeight = height;
+		mJobs[id] = job;
+		Job* jobPtr = job.get();
+		job->mThread = std::thread([this, jobPtr, &aBlockchain, aNodeIdentifier, aOnMined]()
+			{
+				std::optional<Block> block;
+				const MineResult result = aBlockchain.Mine(aNodeIdentifier, jobPtr->mCancelled, block);
+				MiningJobStatus status = MiningJobStatus::Cancelled;
+				if (result == MineResult::Mined)
+				{
+					if (aOnMined)
+					{
+						aOnMined(*block);
+					}
+					status = MiningJobStatus::Mined;
+				}
+				else if (result == MineResult::NothingToMine)
+				{
+					status = MiningJobStatus::NothingToMine;
+				}
+
+				std::lock_guard<std::mutex> lock(mMutex);
+				jobPtr->mInfo.mBlock = std::move(block);
+				jobPtr->mInfo.mStatus = status;
+				mJobDone.notify_all();
+			});
+		return id;
+	}
+
+	void MiningJobs::CancelHeight(uint32_t aHeight)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (auto& job : mJobs)
+		{
+			if (job.second->mInfo.mHeight == aHeight)
+			{
+				job.second->mCancelled.store(true);
+			}
+		}
+	}
+
+	bool MiningJobs::GetInfo(uint64_t anId, MiningJobInfo& anInfoOut) const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto job = mJobs.find(anId);
+		if (job == mJobs.end())
+		{
+			return false;
+		}
+		anInfoOut = job->second->mInfo;
+		return true;
+	}
+
+	bool MiningJobs::Await(uint64_t anId, std::chrono::milliseconds aTimeout, MiningJobInfo& anInfoOut) const
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		auto job = mJobs.find(anId);
+		if (job == mJobs.end())
+		{
+			return false;
+		}
+		//Held by pointer so the job survives RemoveOldJobs while the lock is released
+		const std::shared_ptr<const Job> awaited = job->second;
+		mJobDone.wait_for(lock, aTimeout, [&awaited]() { return awaited->mInfo.mStatus != MiningJobStatus::Running; });
+		anInfoOut = awaited->mInfo;
+		return true;
+	}
+
+	const char* MiningJobs::StatusName(MiningJobStatus aStatus)
+	{
+		switch (aStatus)
+		{
+		case MiningJobStatus::Running:
+			return "running";
+		case MiningJobStatus::Mined:
+			return "mined";
+		case MiningJobStatus::NothingToMine:
+			return "nothing_to_mine";
+		case MiningJobStatus::Cancelled:
+			return "cancelled";
+		}
+		return "unknown";
+	}
+
+	void MiningJobs::RemoveOldJobs()
+	{
+		size_t finished = 0;
+		for (const auto& job : mJobs)
+		{
+			finished += job.second->mInfo.mStatus != MiningJobStatus::Running;
+		}
+		//Oldest first, std::map is ordered by id
+		for (auto job = mJobs.begin(); job != mJobs.end() && finished > MAX_FINISHED_JOBS;)
+		{
+			if (job->second->mInfo.mStatus == MiningJobStatus::Running)
+			{
+				++job;
+				continue;
+			}
+			job->second->mThread.join();
+			job = mJobs.erase(job);
+			finished--;
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "Block.h"
+#include "Blockchain.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace emmaChain {
+	enum class MiningJobStatus
+	{
+		Running,
+		Mined,
+		NothingToMine,
+		Cancelled
+	};
+
+	struct MiningJobInfo
+	{
+		uint64_t mId{};
+		uint32_t mHeight{};
+		MiningJobStatus mStatus{ MiningJobStatus::Running };
+		//Copy of the mined block, set once mStatus is Mined
+		std::optional<Block> mBlock;
+	};
+
+	//Runs Blockchain::Mine on a background thread per job, so /mine can answer with a job id right away
+	class MiningJobs {
+	public:
+		//Called on the job thread after a block was mined, before the job reports Mined
+		using MinedCallback = std::function<void(const Block& aBlock)>;
+
+		MiningJobs() = default;
+		~MiningJobs();
+
+		//Returns the running job if there is one for the same height, mining twice in parallel would only split the CPU
+		uint64_t Start(Blockchain& aBlockchain, const std::string& aNodeIdentifier, MinedCallback aOnMined);
+		//Stops jobs that mine aHeight, used when a block for that height came from elsewhere
+		void CancelHeight(uint32_t aHeight);
+		//Cancels every job and waits for the threads, the Blockchain they mine on has to outlive this call
+		void StopAll();
+
+		bool GetInfo(uint64_t anId, MiningJobInfo& anInfoOut) const;
+		//Waits until the job is done or aTimeout passed, false if there is no such job
+		bool Await(uint64_t anId, std::chrono::milliseconds aTimeout, MiningJobInfo& anInfoOut) const;
+
+		static const char* StatusName(MiningJobStatus aStatus);
+
+	private:
+		struct Job
+		{
+			MiningJobInfo mInfo;
+			std::atomic<bool> mCancelled{ false };
+			std::thread mThread;
+		};
+
+		void RemoveOldJobs();
+
+		mutable std::mutex mMutex;
+		mutable std::condition_variable mJobDone;
+		std::map<uint64_t, std::shared_ptr<Job>> mJobs;
+		uint64_t mNextId{ 1 };
+	};
+}
@@ -0,0 +1,233 @@
+#include "MiningQueue.h"
+
+#include <atomic>
+#include <new>
+
+namespace emmaChain {
+	namespace {
+		constexpr uint32_t LAYOUT_MAGIC = 0x454d5132; //"EMQ2"
+		constexpr uint64_t RESULT_SLOTS = 64;
+		constexpr size_t HEADER_WORDS = (BlockHeader::SIZE + 3) / 4;
+
+		//Both sides run the same build, but the memory is only usable if no process needs a lock for these
+		static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free);
+	}
+
+	struct MiningQueue::Layout
+	{
+		struct Result
+		{
+			//Position in the ring + 1 once mGeneration and mNonce are written
+			std::atomic<uint64_t> mSequence;
+			std::atomic<uint64_t> mGeneration;
+			std::atomic<uint64_t> mNonce;
+		};
+
+		std::atomic<uint32_t> mMagic;
+		std::atomic<uint32_t> mShutDown;
+		//Seqlock around the template, odd while the node rewrites it
+		std::atomic<uint64_t> mGeneration;
+		std::atomic<uint32_t> mActive;
+		std::atomic<uint32_t> mHeaderWords[HEADER_WORDS];
+		//Never reset, so a worker that is still on an old template can't claim nonces twice
+		std::atomic<uint64_t> mNextNonce;
+		std::atomic<uint64_t> mAttempts;
+		std::atomic<uint64_t> mHeartbeat;
+		std::atomic<uint64_t> mResultHead;
+		Result mResults[RESULT_SLOTS];
+	};
+
+	MiningQueue::~MiningQueue()
+	{
+		Close();
+	}
+
+	bool MiningQueue::Create(const std::string& aName)
+	{
+		Close();
+		bool existed = false;
+		if (!mMemory.OpenOrCreate(aName, sizeof(Layout), existed))
+		{
+			return false;
+		}
+		if (!existed)
+		{
+			//The memory comes zero filled, which is a valid state for all the atomics
+			mLayout = new (mMemory.GetData()) Layout;
+			mLayout->mMagic.store(LAYOUT_MAGIC, std::memory_order_release);
+			mIsOwner = true;
+			return true;
+		}
+
+		mLayout = reinterpret_cast<Layout*>(mMemory.GetData());
+		if (mLayout->mMagic.load(std::memory_order_acquire) != LAYOUT_MAGIC)
+		{
+			Close();
+			return false;
+		}
+		mIsOwner = true;
+		//The previous node may have died halfway through a Publish, so the seqlock is forced odd before the template is dropped.
+		//Generations keep counting up, workers still attached see a new one and results posted before are skipped.
+		const uint64_t generation = mLayout->mGeneration.load(std::memory_order_relaxed) | 1;
+		mLayout->mGeneration.store(generation, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		mLayout->mActive.store(0, std::memory_order_relaxed);
+		mLayout->mGeneration.store(generation + 1, std::memory_order_release);
+		mResultTail = mLayout->mResultHead.load(std::memory_order_acquire);
+		mLayout->mShutDown.store(0, std::memory_order_release);
+		return true;
+	}
+
+	bool MiningQueue::Open(const std::string& aName)
+	{
+		Close();
+		if (!mMemory.Open(aName, sizeof(Layout)))
+		{
+			return false;
+		}
+		mLayout = reinterpret_cast<Layout*>(mMemory.GetData());
+		if (mLayout->mMagic.load(std::memory_order_acquire) != LAYOUT_MAGIC)
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void MiningQueue::Close()
+	{
+		if (mLayout && mIsOwner)
+		{
+			Withdraw();
+			mLayout->mShutDown.store(1, std::memory_order_release);
+		}
+		mLayout = nullptr;
+		mIsOwner = false;
+		mResultTail = 0;
+		mMemory.Close();
+	}
+
+	bool MiningQueue::IsOpen() const
+	{
+		return mLayout != nullptr;
+	}
+
+	uint64_t MiningQueue::Publish(const BlockHeader& aHeader)
+	{
+		const auto& bytes = aHeader.Serialize();
+		const uint64_t generation = mLayout->mGeneration.load(std::memory_order_relaxed);
+		mLayout->mGeneration.store(generation + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i = 0; i < HEADER_WORDS; i++)
+		{
+			uint32_t word = 0;
+			for (size_t j = 0; j < 4 && 4 * i + j < bytes.size(); j++)
+			{
+				word |= uint32_t(bytes[4 * i + j]) << (8 * j);
+			}
+			mLayout->mHeaderWords[i].store(word, std::memory_order_relaxed);
+		}
+		mLayout->mActive.store(1, std::memory_order_relaxed);
+		mLayout->mAttempts.store(0, std::memory_order_relaxed);
+		mLayout->mGeneration.store(generation + 2, std::memory_order_release);
+		return generation + 2;
+	}
+
+	void MiningQueue::Withdraw()
+	{
+		const uint64_t generation = mLayout->mGeneration.load(std::memory_order_relaxed);
+		mLayout->mGeneration.store(generation + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		mLayout->mActive.store(0, std::memory_order_relaxed);
+		mLayout->mGeneration.store(generation + 2, std::memory_order_release);
+	}
+
+	bool MiningQueue::PollResult(uint64_t aGeneration, uint64_t& aNonceOut)
+	{
+		while (true)
+		{
+			auto& result = mLayout->mResults[mResultTail % RESULT_SLOTS];
+			const uint64_t sequence = result.mSequence.load(std::memory_order_acquire);
+			if (sequence <= mResultTail)
+			{
+				return false;
+			}
+			//Workers lapped the ring, whatever was overwritten is older than what replaced it
+			mResultTail = sequence;
+			if (result.mGeneration.load(std::memory_order_relaxed) == aGeneration)
+			{
+				aNonceOut = result.mNonce.load(std::memory_order_relaxed);
+				return true;
+			}
+		}
+	}
+
+	uint64_t MiningQueue::GetAttempts() const
+	{
+		return mLayout->mAttempts.load(std::memory_order_relaxed);
+	}
+
+	uint64_t MiningQueue::GetHeartbeat() const
+	{
+		return mLayout->mHeartbeat.load(std::memory_order_relaxed);
+	}
+
+	bool MiningQueue::GetTemplate(uint64_t& aGenerationOut, BlockHeader::Bytes& aHeaderOut) const
+	{
+		const uint64_t generation = mLayout->mGeneration.load(std::memory_order_acquire);
+		if (generation % 2 != 0)
+		{
+			return false;
+		}
+		const bool active = mLayout->mActive.load(std::memory_order_relaxed) != 0;
+		for (size_t i = 0; i < HEADER_WORDS; i++)
+		{
+			const uint32_t word = mLayout->mHeaderWords[i].load(std::memory_order_relaxed);
+			for (size_t j = 0; j < 4 && 4 * i + j < aHeaderOut.size(); j++)
+			{
+				aHeaderOut[4 * i + j] = static_cast<uint8_t>(word >> (8 * j));
+			}
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (!active || mLayout->mGeneration.load(std::memory_order_relaxed) != generation)
+		{
+			return false;
+		}
+		aGenerationOut = generation;
+		return true;
+	}
+
+	bool MiningQueue::IsCurrent(uint64_t aGeneration) const
+	{
+		return mLayout->mGeneration.load(std::memory_order_relaxed) == aGeneration;
+	}
+
+	bool MiningQueue::IsShutDown() const
+	{
+		return mLayout->mShutDown.load(std::memory_order_acquire) != 0;
+	}
+
+	uint64_t MiningQueue::ClaimNonces(uint64_t aCount)
+	{
+		return mLayout->mNextNonce.fetch_add(aCount, std::memory_order_relaxed);
+	}
+
+	void MiningQueue::AddAttempts(uint64_t anAttempts)
+	{
+		mLayout->mAttempts.fetch_add(anAttempts, std::memory_order_relaxed);
+	}
+
+	void MiningQueue::Beat()
+	{
+		mLayout->mHeartbeat.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void MiningQueue::PostResult(uint64_t aGeneration, uint64_t aNonce)
+	{
+		const uint64_t position = mLayout->mResultHead.fetch_add(1, std::memory_order_relaxed);
+		auto& result = mLayout->mResults[position % RESULT_SLOTS];
+		result.mGeneration.store(aGeneration, std::memory_order_relaxed);
+		result.mNonce.store(aNonce, std::memory_order_relaxed);
+		result.mSequence.store(position + 1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "BlockHeader.h"
+
+#include <CommonUtilities/SharedMemory.h>
+
+#include <cstdint>
+#include <string>
+
+namespace emmaChain {
+	//Hands block templates from a node to mining worker processes and found nonces back, all through shared memory.
+	//The node publishes one template at a time, workers claim nonces from a shared counter and post hits to a ring.
+	class MiningQueue {
+	public:
+		MiningQueue() = default;
+		~MiningQueue();
+		MiningQueue(const MiningQueue& aMiningQueue) = delete;
+		MiningQueue& operator=(const MiningQueue& aMiningQueue) = delete;
+
+		//Node side. Workers of a node that ran under aName before may still hold the memory,
+		//it is then taken over with a fresh generation so they mine for this node. False if the memory has another layout.
+		bool Create(const std::string& aName);
+		//Worker side, false if no node created aName or it was built with another layout
+		bool Open(const std::string& aName);
+		//Workers attached to a queue the node closes stop with IsShutDown()
+		void Close();
+		bool IsOpen() const;
+
+		//Node: replaces the template and returns its generation, workers switch to it after their current batch
+		uint64_t Publish(const BlockHeader& aHeader);
+		//Node: workers go idle until the next Publish
+		void Withdraw();
+		//Node: next nonce a worker posted for aGeneration, results of older generations are skipped.
+		//The nonce is not checked here, it comes from another process.
+		bool PollResult(uint64_t aGeneration, uint64_t& aNonceOut);
+		//Node: attempts reported by all workers since the last Publish
+		uint64_t GetAttempts() const;
+		//Node: changes as long as at least one worker is attached and running
+		uint64_t GetHeartbeat() const;
+
+		//Worker: the template to mine, false while there is none
+		bool GetTemplate(uint64_t& aGenerationOut, BlockHeader::Bytes& aHeaderOut) const;
+		bool IsCurrent(uint64_t aGeneration) const;
+		bool IsShutDown() const;
+		//Worker: first of aCount nonces no other worker gets
+		uint64_t ClaimNonces(uint64_t aCount);
+		void AddAttempts(uint64_t anAttempts);
+		//Worker: called whenever it polls or claims, so the node can tell it is there
+		void Beat();
+		void PostResult(uint64_t aGeneration, uint64_t aNonce);
+
+	private:
+		struct Layout;
+
+		CU::SharedMemory mMemory;
+		Layout* mLayout{};
+		//Only the node reads results, so its read position stays in its own process
+		uint64_t mResultTail{};
+		bool mIsOwner{};
+	};
+}
@@ -0,0 +1,93 @@
+#include "MiningStats.h"
+
+#include <numeric>
+
+namespace emmaChain {
+	uint64_t MiningRun::GetAttempts() const
+	{
+		return std::accumulate(mThreadAttempts.begin(), mThreadAttempts.end(), uint64_t(0));
+	}
+
+	void MiningStats::AddRun(uint32_t aHeight, const MiningRun& aRun)
+	{
+		const uint64_t attempts = aRun.GetAttempts();
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRunCount++;
+		mTotalAttempts += attempts;
+		mTotalSeconds += aRun.mSeconds;
+		mLastRun = aRun;
+		if (!aRun.mFound)
+		{
+			return;
+		}
+
+		//Cancelled runs say nothing about how long a proof takes, so only found ones are in the histogram
+		mProofsFound++;
+		const double milliseconds = aRun.mSeconds * 1000.0;
+		size_t bucket = 0;
+		while (bucket + 1 < HISTOGRAM_BUCKETS && milliseconds >= static_cast<double>(GetBucketLimitMs(bucket)))
+		{
+			bucket++;
+		}
+		mTimeToProof[bucket]++;
+
+		mRecentBlocks.push_back({ aHeight, aRun.mProof, attempts, aRun.mSeconds });
+		if (mRecentBlocks.size() > RECENT_BLOCKS)
+		{
+			mRecentBlocks.pop_front();
+		}
+	}
+
+	uint64_t MiningStats::GetRunCount() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mRunCount;
+	}
+
+	uint64_t MiningStats::GetProofsFound() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mProofsFound;
+	}
+
+	uint64_t MiningStats::GetTotalAttempts() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mTotalAttempts;
+	}
+
+	double MiningStats::GetTotalSeconds() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mTotalSeconds;
+	}
+
+	double MiningStats::GetHashRate() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mTotalSeconds > 0.0 ? mTotalAttempts / mTotalSeconds : 0.0;
+	}
+
+	MiningRun MiningStats::GetLastRun() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mLastRun;
+	}
+
+	std::vector<uint64_t> MiningStats::GetTimeToProofHistogram() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return std::vector<uint64_t>(std::begin(mTimeToProof), std::end(mTimeToProof));
+	}
+
+	std::vector<MiningStats::RecentBlock> MiningStats::GetRecentBlocks() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return std::vector<RecentBlock>(mRecentBlocks.begin(), mRecentBlocks.end());
+	}
+
+	uint64_t MiningStats::GetBucketLimitMs(size_t anIndex)
+	{
+		return anIndex + 1 < HISTOGRAM_BUCKETS ? uint64_t(1) << anIndex : 0;
+	}
+}
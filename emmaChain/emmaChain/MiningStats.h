@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace emmaChain {
+	//What one Miner::FindProof call did, filled in by the Miner
+	struct MiningRun
+	{
+		bool mFound{};
+		int64_t mProof{};
+		float mSeconds{};
+		//One entry per worker thread
+		std::vector<uint64_t> mThreadAttempts;
+		std::vector<float> mThreadSeconds;
+
+		uint64_t GetAttempts() const;
+	};
+
+	//Counters over all proof-of-work runs of a node, safe to read while mining
+	class MiningStats {
+	public:
+		//Runs faster than 2^i ms land in bucket i, the last bucket takes everything slower
+		static constexpr size_t HISTOGRAM_BUCKETS = 20;
+		//Found proofs kept for GetRecentBlocks()
+		static constexpr size_t RECENT_BLOCKS = 32;
+
+		struct RecentBlock
+		{
+			uint32_t mHeight{};
+			int64_t mProof{};
+			uint64_t mAttempts{};
+			float mSeconds{};
+		};
+
+		void AddRun(uint32_t aHeight, const MiningRun& aRun);
+
+		uint64_t GetRunCount() const;
+		uint64_t GetProofsFound() const;
+		uint64_t GetTotalAttempts() const;
+		double GetTotalSeconds() const;
+		//Attempts per second over every run so far
+		double GetHashRate() const;
+		MiningRun GetLastRun() const;
+		std::vector<uint64_t> GetTimeToProofHistogram() const;
+		std::vector<RecentBlock> GetRecentBlocks() const;
+
+		//Upper bound of histogram bucket anIndex in milliseconds, 0 for the last one which has none
+		static uint64_t GetBucketLimitMs(size_t anIndex);
+
+	private:
+		mutable std::mutex mMutex;
+		uint64_t mRunCount{};
+		uint64_t mProofsFound{};
+		uint64_t mTotalAttempts{};
+		double mTotalSeconds{};
+		MiningRun mLastRun;
+		uint64_t mTimeToProof[HISTOGRAM_BUCKETS]{};
+		std::deque<RecentBlock> mRecentBlocks;
+	};
+}
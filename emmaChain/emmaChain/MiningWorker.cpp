@@ -0,0 +1,82 @@
+#include "MiningWorker.h"
+
+#include "MiningQueue.h"
+
+#include <CommonUtilities/sha256/sha256.h>
+#include <CommonUtilities/ThreadAffinity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace emmaChain {
+	namespace {
+		//Nonces claimed from the shared counter at a time
+		constexpr uint64_t CLAIM_SIZE = 1 << 12;
+		constexpr std::chrono::milliseconds IDLE_POLL_INTERVAL{ 1 };
+
+		//Mines one template until a nonce is found or the node moves on
+		void MineTemplate(MiningQueue& aQueue, uint64_t aGeneration, const BlockHeader::Bytes& aHeader)
+		{
+			CU::SHA256 headerContext;
+			headerContext.update(aHeader.data(), BlockHeader::NONCE_OFFSET);
+			const CU::SHA256Target target = CU::sha256TargetFromCompact(BlockHeader::ReadTargetBits(aHeader));
+
+			NonceBatch nonceBatch;
+
+			while (aQueue.IsCurrent(aGeneration))
+			{
+				aQueue.Beat();
+				const uint64_t begin = aQueue.ClaimNonces(CLAIM_SIZE);
+				uint64_t attempts = 0;
+				for (uint64_t batch = begin; batch < begin + CLAIM_SIZE && aQueue.IsCurrent(aGeneration); batch += nonceBatch.mLanes)
+				{
+					const size_t count = static_cast<size_t>(std::min<uint64_t>(nonceBatch.mLanes, begin + CLAIM_SIZE - batch));
+					const size_t found = nonceBatch.Find(headerContext, batch, count, target);
+					attempts += count;
+					if (found < count)
+					{
+						aQueue.AddAttempts(attempts);
+						aQueue.PostResult(aGeneration, batch + found);
+						return;
+					}
+				}
+				aQueue.AddAttempts(attempts);
+			}
+		}
+	}
+
+	int RunMiningWorker(const std::string& aQueueName, int aCore)
+	{
+		MiningQueue queue;
+		if (!queue.Open(aQueueName))
+		{
+			std::cout << "No mining queue named " << aQueueName << std::endl;
+			return 1;
+		}
+		if (aCore >= 0 && !CU::ThreadAffinity::PinCurrentThread(static_cast<unsigned int>(aCore)))
+		{
+			std::cout << "Can't pin the worker to core " << aCore << std::endl;
+			return 1;
+		}
+
+		std::cout << "Mining for " << aQueueName << std::endl;
+		uint64_t lastGeneration = 0;
+		while (!queue.IsShutDown())
+		{
+			queue.Beat();
+			uint64_t generation = 0;
+			BlockHeader::Bytes header;
+			//A template this worker already solved stays published until the node has checked the nonce
+			if (!queue.GetTemplate(generation, header) || generation == lastGeneration)
+			{
+				std::this_thread::sleep_for(IDLE_POLL_INTERVAL);
+				continue;
+			}
+			MineTemplate(queue, generation, header);
+			lastGeneration = generation;
+		}
+		return 0;
+	}
+}
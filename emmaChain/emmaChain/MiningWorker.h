@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+
+namespace emmaChain {
+	//Body of a mining worker process: attaches to the queue a node created under aQueueName and mines
+	//whatever template it publishes until the node closes the queue. A negative aCore leaves the thread unpinned.
+	//Returns the process exit code.
+	int RunMiningWorker(const std::string& aQueueName, int aCore);
+}
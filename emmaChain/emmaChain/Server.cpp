@@ -5,6 +5,7 @@
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <CommonUtilities/sha256/sha256.h>
 #include <Poco/Net/DNS.h>
 #include <Poco/Net/HTTPClientSession.h>
 #include <Poco/Net/HTTPRequest.h>
@@ -13,40 +14,54 @@
 #include <Poco/URI.h>
 #include <rapidjson/document.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+
 
 namespace emmaChain {
-	void WriteTransactionAsJsonResponse(crow::json::wvalue& aJsonResponse, const Transaction& aTransaction, unsigned int aTransactionIndex, bool aWriteInChain, unsigned int aBlockIndex = 0)
+	namespace {
+		constexpr int64_t DEFAULT_AWAIT_TIMEOUT_MS = 30000;
+		constexpr int64_t MAX_AWAIT_TIMEOUT_MS = 300000;
+		//Amount buckets of /transactions/amounts without a bounds parameter
+		const std::vector<uint32_t> DEFAULT_AMOUNT_BOUNDS = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+	}
+
+	void WriteTransactionAsJsonResponse(crow::json::wvalue& aJsonResponse, const TransactionView& aTransaction, unsigned int aTransactionIndex, bool aWriteInChain, unsigned int aBlockIndex = 0)
 	{
 		if (!aWriteInChain)
 		{
-			aJsonResponse["transactions"][aTransactionIndex]["sender"] = aTransaction.mSender;
-			aJsonResponse["transactions"][aTransactionIndex]["recipient"] = aTransaction.mRecipient;
+			aJsonResponse["transactions"][aTransactionIndex]["sender"] = aTransaction.GetSender();
+			aJsonResponse["transactions"][aTransactionIndex]["recipient"] = aTransaction.GetRecipient();
 			aJsonResponse["transactions"][aTransactionIndex]["amount"] = aTransaction.mAmount;
-			aJsonResponse["transactions"][aTransactionIndex]["message"] = aTransaction.mMessage;
+			aJsonResponse["transactions"][aTransactionIndex]["message"] = std::string(aTransaction.mMessage);
 		}
 		else
 		{
-			aJsonResponse["chain"][aBlockIndex]["transactions"][aTransactionIndex]["sender"] = aTransaction.mSender;
-			aJsonResponse["chain"][aBlockIndex]["transactions"][aTransactionIndex]["recipient"] = aTransaction.mRecipient;
+			aJsonResponse["chain"][aBlockIndex]["transactions"][aTransactionIndex]["sender"] = aTransaction.GetSender();
+			aJsonResponse["chain"][aBlockIndex]["transactions"][aTransactionIndex]["recipient"] = aTransaction.GetRecipient();
 			aJsonResponse["chain"][aBlockIndex]["transactions"][aTransactionIndex]["amount"] = aTransaction.mAmount;
-			aJsonResponse["chain"][aBlockIndex]["transactions"][aTransactionIndex]["message"] = aTransaction.mMessage;
+			aJsonResponse["chain"][aBlockIndex]["transactions"][aTransactionIndex]["message"] = std::string(aTransaction.mMessage);
 		}
 	}
 
 	void WriteChainAsJsonResponse(crow::json::wvalue& aJsonResponse, const Blockchain& aBlockchain)
 	{
-		const auto& chain = aBlockchain.GetChain();
+		//A pruned block's transactions are read back from the block store, without it the block goes out without them
+		const auto chain = aBlockchain.GetChainWithBodies();
 		aJsonResponse["length"] = chain.size();
 		unsigned int blockIndex = 0;
 		for (const auto& block : chain)
 		{
 			aJsonResponse["chain"][blockIndex]["index"] = block.GetIndex();
-			aJsonResponse["chain"][blockIndex]["previous_hash"] = block.GetPreviousHash();
+			aJsonResponse["chain"][blockIndex]["previous_hash"] = CU::sha256ToHex(block.GetPreviousHash());
 			aJsonResponse["chain"][blockIndex]["timestamp"] = block.GetTimestamp();
 			aJsonResponse["chain"][blockIndex]["proof"] = block.GetProof();
-			const auto& transactions = block.GetTransactions();
+			aJsonResponse["chain"][blockIndex]["target"] = block.GetTargetBits();
 			unsigned int transactionIndex = 0;
-			for (const auto& transaction : transactions)
+			for (const auto& transaction : block.GetTransactions())
 			{
 				WriteTransactionAsJsonResponse(aJsonResponse, transaction, transactionIndex, true, blockIndex);
 				transactionIndex++;
@@ -55,6 +70,139 @@ namespace emmaChain {
 		}
 	}
 
+	void WriteBlockAsJsonResponse(crow::json::wvalue& aJsonResponse, const Block& aBlock)
+	{
+		aJsonResponse["index"] = aBlock.GetIndex();
+		aJsonResponse["hash"] = aBlock.GetHash();
+		aJsonResponse["previous_hash"] = CU::sha256ToHex(aBlock.GetPreviousHash());
+		aJsonResponse["timestamp"] = aBlock.GetTimestamp();
+		aJsonResponse["proof"] = aBlock.GetProof();
+		aJsonResponse["target"] = aBlock.GetTargetBits();
+		const auto& transactions = aBlock.GetTransactions();
+		unsigned int transactionIndex = 0;
+		for (const auto& transaction : transactions)
+		{
+			WriteTransactionAsJsonResponse(aJsonResponse, transaction, transactionIndex, false);
+			transactionIndex++;
+		}
+	}
+
+	void WriteMiningJobAsJsonResponse(crow::json::wvalue& aJsonResponse, const MiningJobInfo& anInfo)
+	{
+		aJsonResponse["job_id"] = anInfo.mId;
+		aJsonResponse["height"] = anInfo.mHeight;
+		aJsonResponse["status"] = MiningJobs::StatusName(anInfo.mStatus);
+		if (anInfo.mStatus == MiningJobStatus::Running)
+		{
+			aJsonResponse["message"] = "Mining block " + std::to_string(anInfo.mHeight);
+			return;
+		}
+		if (!anInfo.mBlock)
+		{
+			aJsonResponse["message"] = anInfo.mStatus == MiningJobStatus::NothingToMine ? "No transactions to mine" : "Mining was cancelled";
+			return;
+		}
+
+		const Block& block = *anInfo.mBlock;
+		aJsonResponse["message"] = "Block " + std::to_string(block.GetIndex()) + " has been mined";
+		WriteBlockAsJsonResponse(aJsonResponse, block);
+	}
+
+	void WriteMiningStatsAsJsonResponse(crow::json::wvalue& aJsonResponse, const MiningStats& someStats)
+	{
+		aJsonResponse["runs"] = someStats.GetRunCount();
+		aJsonResponse["proofs_found"] = someStats.GetProofsFound();
+		aJsonResponse["attempts"] = someStats.GetTotalAttempts();
+		aJsonResponse["seconds"] = someStats.GetTotalSeconds();
+		aJsonResponse["hashes_per_second"] = someStats.GetHashRate();
+
+		const MiningRun lastRun = someStats.GetLastRun();
+		aJsonResponse["last_run"]["found"] = lastRun.mFound;
+		aJsonResponse["last_run"]["attempts"] = lastRun.GetAttempts();
+		aJsonResponse["last_run"]["seconds"] = lastRun.mSeconds;
+		for (unsigned int thread = 0; thread < lastRun.mThreadAttempts.size(); thread++)
+		{
+			const float seconds = lastRun.mThreadSeconds[thread];
+			aJsonResponse["last_run"]["threads"][thread]["attempts"] = lastRun.mThreadAttempts[thread];
+			aJsonResponse["last_run"]["threads"][thread]["seconds"] = seconds;
+			aJsonResponse["last_run"]["threads"][thread]["hashes_per_second"] = seconds > 0.0f ? lastRun.mThreadAttempts[thread] / seconds : 0.0;
+		}
+
+		const auto& histogram = someStats.GetTimeToProofHistogram();
+		for (unsigned int bucket = 0; bucket < histogram.size(); bucket++)
+		{
+			//The last bucket has no upper bound and leaves below_ms out
+			if (const uint64_t limit = MiningStats::GetBucketLimitMs(bucket))
+			{
+				aJsonResponse["time_to_proof"][bucket]["below_ms"] = limit;
+			}
+			aJsonResponse["time_to_proof"][bucket]["count"] = histogram[bucket];
+		}
+
+		const auto& recentBlocks = someStats.GetRecentBlocks();
+		for (unsigned int blockIndex = 0; blockIndex < recentBlocks.size(); blockIndex++)
+		{
+			const auto& block = recentBlocks[blockIndex];
+			aJsonResponse["recent_blocks"][blockIndex]["index"] = block.mHeight;
+			aJsonResponse["recent_blocks"][blockIndex]["proof"] = block.mProof;
+			aJsonResponse["recent_blocks"][blockIndex]["attempts"] = block.mAttempts;
+			aJsonResponse["recent_blocks"][blockIndex]["seconds"] = block.mSeconds;
+		}
+	}
+
+	//The from and to url parameters as a height range, the whole chain without them.
+	//With pruning the columns only cover heights from their first_height on, which the responses report.
+	void ReadHeightRange(const crow::request& aRequest, uint32_t& aFromOut, uint32_t& aToOut)
+	{
+		aFromOut = 0;
+		aToOut = TransactionColumns::END_HEIGHT;
+		if (const char* from = aRequest.url_params.get("from"))
+		{
+			aFromOut = static_cast<uint32_t>(std::strtoul(from, nullptr, 10));
+		}
+		if (const char* to = aRequest.url_params.get("to"))
+		{
+			aToOut = static_cast<uint32_t>(std::strtoul(to, nullptr, 10));
+		}
+	}
+
+	//Comma separated amounts, false unless there is at least one and they are ascending
+	bool ReadAmountBounds(const char* aList, std::vector<uint32_t>& someBoundsOut)
+	{
+		someBoundsOut.clear();
+		const char* cursor = aList;
+		while (*cursor != '\0')
+		{
+			char* end = nullptr;
+			const unsigned long long bound = std::strtoull(cursor, &end, 10);
+			if (end == cursor || bound > std::numeric_limits<uint32_t>::max() || (!someBoundsOut.empty() && bound <= someBoundsOut.back()))
+			{
+				return false;
+			}
+			someBoundsOut.push_back(static_cast<uint32_t>(bound));
+			if (*end != ',' && *end != '\0')
+			{
+				return false;
+			}
+			cursor = *end == ',' ? end + 1 : end;
+		}
+		return !someBoundsOut.empty();
+	}
+
+	void WriteAmountHistogramAsJsonResponse(crow::json::wvalue& aJsonResponse, const std::vector<uint32_t>& someBounds, const std::vector<size_t>& someBuckets)
+	{
+		for (unsigned int bucket = 0; bucket < someBuckets.size(); bucket++)
+		{
+			//The first bucket starts at 0 and the last one has no upper bound
+			aJsonResponse["buckets"][bucket]["from"] = bucket == 0 ? 0 : someBounds[bucket - 1];
+			if (bucket < someBounds.size())
+			{
+				aJsonResponse["buckets"][bucket]["below"] = someBounds[bucket];
+			}
+			aJsonResponse["buckets"][bucket]["count"] = someBuckets[bucket];
+		}
+	}
+
 	Server::Server(short aPort) : mPort(aPort)
 	{
 		boost::uuids::uuid uuid = boost::uuids::random_generator()();
@@ -66,88 +214,151 @@ namespace emmaChain {
 		CROW_ROUTE(mApp, "/block/add")
 			.methods("POST"_method)
 			([&](const crow::request& aRequest) {
-			auto values = crow::json::load(aRequest.body);
-			if (!values)
+			//Every member is checked before it is read, a block from a peer can't make the node answer 500
+			std::optional<Block> block;
+			if (!Blockchain::ConstructBlockFromJson(aRequest.body, block))
 			{
-				return crow::response(400);
+				return crow::response{ 400, "Error: a member of the block is missing or mistyped, or previous_hash is not a SHA-256 hex digest" };
 			}
-
-			std::vector<Transaction> blockTransactions;
-			auto transactionsJson = values["transactions"];
-			for (const auto& transaction : transactionsJson)
-			{
-				blockTransactions.push_back(Transaction{ transaction["sender"].s(),
-																	transaction["recipient"].s(),
-																	transaction["message"].s(),
-																	static_cast<uint32_t>(transaction["amount"].u()) });
-			}
-			Block newBlock(values["index"].u(), values["proof"].i(), values["previous_hash"].s(),
-				blockTransactions, values["timestamp"].i());
+			const Block& newBlock = *block;
 
 			bool result = aBlockchain.AddBlock(newBlock);
 			if (!result)
 			{
 				return crow::response{ 400, "The block was discarded by the node" };
 			}
+			//A job still mining this height could only produce a stale block
+			mMiningJobs.CancelHeight(newBlock.GetIndex());
 			return crow::response{ "Block added to the chain" };
 				});
 
 
 		CROW_ROUTE(mApp, "/mine")([&]() {
 			crow::json::wvalue jsonResponse;
-			bool result = aBlockchain.Mine(mNodeIdentifier);
-			if (!result)
+			if (!aBlockchain.HasPendingTransactions())
 			{
 				jsonResponse["message"] = "No transactions to mine";
 				return jsonResponse;
 			}
 
-			const auto& lastBlock = aBlockchain.GetLastBlock();
-			bool replaced = aBlockchain.ResolveConflicts();
-			if (!replaced)
-			{
-				std::string requestBody("{");
-				requestBody += "\"index\":" + std::to_string(lastBlock.GetIndex()) + ",";
-				requestBody += "\"previous_hash\":\"" + lastBlock.GetPreviousHash() + "\",";
-				requestBody += "\"timestamp\":" + std::to_string(lastBlock.GetTimestamp()) + ",";
-				requestBody += "\"proof\":" + std::to_string(lastBlock.GetProof()) + ",";
-				requestBody += "\"transactions\":[";
-				unsigned int transactionIndex = 0;
-				for (const auto& transaction : lastBlock.GetTransactions())
+			const uint64_t jobId = mMiningJobs.Start(aBlockchain, mNodeIdentifier, [this, &aBlockchain](const Block& aBlock) {
+				if (!aBlockchain.ResolveConflicts())
 				{
-					requestBody += "{";
-					requestBody += "\"sender\":\"" + transaction.mSender + "\",";
-					requestBody += "\"recipient\":\"" + transaction.mRecipient + "\",";
-					requestBody += "\"message\":\"" + transaction.mMessage + "\",";
-					requestBody += "\"amount\":" + std::to_string(transaction.mAmount);
-					requestBody += "},";
-					transactionIndex++;
+					BroadcastBlock(aBlock, aBlockchain);
 				}
-				requestBody.pop_back();
-				requestBody += "]}";
+				});
+			MiningJobInfo info;
+			mMiningJobs.GetInfo(jobId, info);
+			WriteMiningJobAsJsonResponse(jsonResponse, info);
+			return jsonResponse;
+			});
 
-				const auto& otherNodes = aBlockchain.GetNodes();
-				for (const auto& node : otherNodes)
-				{
-					HttpPost("http://" + node + "/block/add", requestBody, { {"content_type" , "application/json"} });
-				}
+
+		CROW_ROUTE(mApp, "/mine/status/<uint>")([&](uint64_t aJobId) {
+			MiningJobInfo info;
+			if (!mMiningJobs.GetInfo(aJobId, info))
+			{
+				return crow::response(404, "Error: Unknown mining job");
 			}
+			crow::json::wvalue jsonResponse;
+			WriteMiningJobAsJsonResponse(jsonResponse, info);
+			return crow::response(jsonResponse);
+			});
 
-			jsonResponse["message"] = "Block " + std::to_string(lastBlock.GetIndex()) + " has been mined";
-			jsonResponse["index"] = lastBlock.GetIndex();
-			jsonResponse["proof"] = lastBlock.GetProof();
-			jsonResponse["previous_hash"] = lastBlock.GetPreviousHash();
-			const auto& transactions = lastBlock.GetTransactions();
-			unsigned int transactionIndex = 0;
-			for (const auto& transaction : transactions)
+
+		CROW_ROUTE(mApp, "/mine/await/<uint>")([&](const crow::request& aRequest, uint64_t aJobId) {
+			//Answers when the job is done or after timeout_ms with the job still running
+			int64_t timeoutMs = DEFAULT_AWAIT_TIMEOUT_MS;
+			if (const char* timeout = aRequest.url_params.get("timeout_ms"))
 			{
-				WriteTransactionAsJsonResponse(jsonResponse, transaction, transactionIndex, false);
-				transactionIndex++;
+				timeoutMs = std::clamp<int64_t>(std::atoll(timeout), 0, MAX_AWAIT_TIMEOUT_MS);
 			}
+			MiningJobInfo info;
+			if (!mMiningJobs.Await(aJobId, std::chrono::milliseconds(timeoutMs), info))
+			{
+				return crow::response(404, "Error: Unknown mining job");
+			}
+			crow::json::wvalue jsonResponse;
+			WriteMiningJobAsJsonResponse(jsonResponse, info);
+			return crow::response(jsonResponse);
+			});
+
+
+		CROW_ROUTE(mApp, "/mining/stats")([&]() {
+			crow::json::wvalue jsonResponse;
+			WriteMiningStatsAsJsonResponse(jsonResponse, aBlockchain.GetMiningStats());
 			return jsonResponse;
 			});
 
 
+		CROW_ROUTE(mApp, "/block/hash/<string>")([&](const std::string& aHash) {
+			std::optional<Block> block;
+			if (!aBlockchain.FindBlock(aHash, block))
+			{
+				return crow::response(404, "Error: No block with that hash on this chain");
+			}
+			crow::json::wvalue jsonResponse;
+			WriteBlockAsJsonResponse(jsonResponse, *block);
+			return crow::response(jsonResponse);
+			});
+
+
+		CROW_ROUTE(mApp, "/transactions/volume")([&](const crow::request& aRequest) {
+			uint32_t from = 0;
+			uint32_t to = 0;
+			ReadHeightRange(aRequest, from, to);
+			const auto& columns = aBlockchain.GetTransactionColumns();
+			crow::json::wvalue jsonResponse;
+			jsonResponse["first_height"] = columns.GetFirstHeight();
+			jsonResponse["transactions"] = columns.GetCount(from, to);
+			jsonResponse["volume"] = columns.GetVolume(from, to);
+			return jsonResponse;
+			});
+
+
+		CROW_ROUTE(mApp, "/transactions/address/<string>")([&](const crow::request& aRequest, const std::string& anAddress) {
+			uint32_t from = 0;
+			uint32_t to = 0;
+			ReadHeightRange(aRequest, from, to);
+			//An address no transaction has used simply has nothing sent or received
+			const auto& columns = aBlockchain.GetTransactionColumns();
+			AddressSummary summary;
+			AddressId address = 0;
+			if (aBlockchain.GetAddresses().Find(anAddress, address))
+			{
+				summary = columns.GetAddressSummary(address, from, to);
+			}
+			crow::json::wvalue jsonResponse;
+			jsonResponse["first_height"] = columns.GetFirstHeight();
+			jsonResponse["address"] = anAddress;
+			jsonResponse["sent"] = summary.mSent;
+			jsonResponse["received"] = summary.mReceived;
+			jsonResponse["sent_count"] = summary.mSentCount;
+			jsonResponse["received_count"] = summary.mReceivedCount;
+			return jsonResponse;
+			});
+
+
+		CROW_ROUTE(mApp, "/transactions/amounts")([&](const crow::request& aRequest) {
+			uint32_t from = 0;
+			uint32_t to = 0;
+			ReadHeightRange(aRequest, from, to);
+			std::vector<uint32_t> bounds = DEFAULT_AMOUNT_BOUNDS;
+			if (const char* boundList = aRequest.url_params.get("bounds"))
+			{
+				if (!ReadAmountBounds(boundList, bounds))
+				{
+					return crow::response(400, "Error: bounds has to be a comma separated list of ascending amounts");
+				}
+			}
+			const auto& columns = aBlockchain.GetTransactionColumns();
+			crow::json::wvalue jsonResponse;
+			jsonResponse["first_height"] = columns.GetFirstHeight();
+			WriteAmountHistogramAsJsonResponse(jsonResponse, bounds, columns.GetAmountHistogram(bounds, from, to));
+			return crow::response(jsonResponse);
+			});
+
+
 		CROW_ROUTE(mApp, "/chain")([&]() {
 			crow::json::wvalue jsonResponse;
 			WriteChainAsJsonResponse(jsonResponse, aBlockchain);
@@ -175,7 +386,7 @@ namespace emmaChain {
 
 			crow::json::wvalue jsonResponse;
 			jsonResponse["message"] = "New nodes have been added";
-			const auto& allNodes = aBlockchain.GetNodes();
+			const auto allNodes = aBlockchain.GetNodes();
 			unsigned int nodeIndex = 0;
 			for (const auto& node : allNodes)
 			{
@@ -273,7 +484,7 @@ namespace emmaChain {
 
 		CROW_ROUTE(mApp, "/transactions/pending")([&]() {
 			crow::json::wvalue jsonResponse;
-			const auto& pendingTransacations = aBlockchain.GetPendingTransactions();
+			const auto pendingTransacations = aBlockchain.GetPendingTransactions();
 			unsigned int transactionIndex = 0;
 			for (const auto& transaction : pendingTransacations)
 			{
@@ -288,6 +499,35 @@ namespace emmaChain {
 	void Server::Run()
 	{
 		mApp.port(mPort).multithreaded().run();
+		mMiningJobs.StopAll();
+	}
+
+	void Server::BroadcastBlock(const Block& aBlock, const Blockchain& aBlockchain)
+	{
+		std::string requestBody("{");
+		requestBody += "\"index\":" + std::to_string(aBlock.GetIndex()) + ",";
+		requestBody += "\"previous_hash\":\"" + CU::sha256ToHex(aBlock.GetPreviousHash()) + "\",";
+		requestBody += "\"timestamp\":" + std::to_string(aBlock.GetTimestamp()) + ",";
+		requestBody += "\"proof\":" + std::to_string(aBlock.GetProof()) + ",";
+		requestBody += "\"target\":" + std::to_string(aBlock.GetTargetBits()) + ",";
+		requestBody += "\"transactions\":[";
+		for (const auto& transaction : aBlock.GetTransactions())
+		{
+			requestBody += "{";
+			requestBody += "\"sender\":\"" + transaction.GetSender() + "\",";
+			requestBody += "\"recipient\":\"" + transaction.GetRecipient() + "\",";
+			requestBody += "\"message\":\"" + std::string(transaction.mMessage) + "\",";
+			requestBody += "\"amount\":" + std::to_string(transaction.mAmount);
+			requestBody += "},";
+		}
+		requestBody.pop_back();
+		requestBody += "]}";
+
+		const auto otherNodes = aBlockchain.GetNodes();
+		for (const auto& node : otherNodes)
+		{
+			HttpPost("http://" + node + "/block/add", requestBody, { {"content_type" , "application/json"} });
+		}
 	}
 
 	std::string Server::HttpGet(const std::string& anAddress)
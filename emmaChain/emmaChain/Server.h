@@ -1,4 +1,5 @@
 #pragma once
+#include "MiningJobs.h"
 
 #include <crow/include/crow.h>
 
@@ -14,8 +15,6 @@ namespace Poco {
 }
 
 namespace emmaChain {
-	class Blockchain;
-
 	class Server {
 	public:
 		Server(short aPort);
@@ -27,7 +26,10 @@ namespace emmaChain {
 		std::string GetMyHttpAdress();
 
 	private:
+		void BroadcastBlock(const Block& aBlock, const Blockchain& aBlockchain);
+
 		crow::SimpleApp mApp;
+		MiningJobs mMiningJobs;
 		std::string mNodeIdentifier;
 		short mPort{};
 	};
@@ -1,5 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace emmaChain {
 	struct Transaction {
@@ -8,4 +10,35 @@ namespace emmaChain {
 		std::string mMessage;
 		uint32_t mAmount{};
 	};
+
+	//A transaction that doesn't own its strings, e.g. one inside a BlockBody
+	struct TransactionView {
+		TransactionView(const std::string& aSender, const std::string& aRecipient, std::string_view aMessage, uint32_t anAmount)
+			: mSender(&aSender)
+			, mRecipient(&aRecipient)
+			, mMessage(aMessage)
+			, mAmount(anAmount)
+		{
+		}
+
+		TransactionView(const Transaction& aTransaction)
+			: TransactionView(aTransaction.mSender, aTransaction.mRecipient, aTransaction.mMessage, aTransaction.mAmount)
+		{
+		}
+
+		const std::string& GetSender() const
+		{
+			return *mSender;
+		}
+
+		const std::string& GetRecipient() const
+		{
+			return *mRecipient;
+		}
+
+		const std::string* mSender{};
+		const std::string* mRecipient{};
+		std::string_view mMessage;
+		uint32_t mAmount{};
+	};
 }
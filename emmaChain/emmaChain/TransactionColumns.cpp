@@ -0,0 +1,110 @@
+#include "TransactionColumns.h"
+
+#include <CommonUtilities/ColumnScan.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace emmaChain {
+	void TransactionColumns::Append(const Block& aBlock)
+	{
+		const uint32_t height = static_cast<uint32_t>(aBlock.GetIndex());
+		const BlockBody& body = aBlock.GetTransactions();
+		std::unique_lock<std::shared_mutex> lock(mMutex);
+		for (size_t i = 0; i < body.GetCount(); i++)
+		{
+			mHeights.push_back(height);
+			mAmounts.push_back(body[i].mAmount);
+			mSenders.push_back(body.GetSenderId(i));
+			mRecipients.push_back(body.GetRecipientId(i));
+		}
+	}
+
+	void TransactionColumns::Truncate(uint32_t aHeight)
+	{
+		std::unique_lock<std::shared_mutex> lock(mMutex);
+		const size_t count = GetRange(0, aHeight).second;
+		mHeights.resize(count);
+		mAmounts.resize(count);
+		mSenders.resize(count);
+		mRecipients.resize(count);
+		mFirstHeight = std::min(mFirstHeight, aHeight);
+	}
+
+	void TransactionColumns::DropBelow(uint32_t aHeight)
+	{
+		std::unique_lock<std::shared_mutex> lock(mMutex);
+		if (aHeight <= mFirstHeight)
+		{
+			return;
+		}
+		mFirstRow = GetRange(0, aHeight).second;
+		mFirstHeight = aHeight;
+		if (2 * mFirstRow >= mHeights.size())
+		{
+			mHeights.erase(mHeights.begin(), mHeights.begin() + mFirstRow);
+			mAmounts.erase(mAmounts.begin(), mAmounts.begin() + mFirstRow);
+			mSenders.erase(mSenders.begin(), mSenders.begin() + mFirstRow);
+			mRecipients.erase(mRecipients.begin(), mRecipients.begin() + mFirstRow);
+			mFirstRow = 0;
+		}
+	}
+
+	uint32_t TransactionColumns::GetFirstHeight() const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		return mFirstHeight;
+	}
+
+	size_t TransactionColumns::GetCount(uint32_t aFromHeight, uint32_t aToHeight) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		const auto range = GetRange(aFromHeight, aToHeight);
+		return range.second - range.first;
+	}
+
+	uint64_t TransactionColumns::GetVolume(uint32_t aFromHeight, uint32_t aToHeight) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		const auto range = GetRange(aFromHeight, aToHeight);
+		return CU::ColumnScan::Sum(mAmounts.data() + range.first, range.second - range.first);
+	}
+
+	AddressSummary TransactionColumns::GetAddressSummary(AddressId anAddress, uint32_t aFromHeight, uint32_t aToHeight) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		const auto range = GetRange(aFromHeight, aToHeight);
+		const size_t count = range.second - range.first;
+		AddressSummary summary;
+		summary.mSent = CU::ColumnScan::SumWhereEqual(mAmounts.data() + range.first, mSenders.data() + range.first, count, anAddress);
+		summary.mReceived = CU::ColumnScan::SumWhereEqual(mAmounts.data() + range.first, mRecipients.data() + range.first, count, anAddress);
+		summary.mSentCount = CU::ColumnScan::CountWhereEqual(mSenders.data() + range.first, count, anAddress);
+		summary.mReceivedCount = CU::ColumnScan::CountWhereEqual(mRecipients.data() + range.first, count, anAddress);
+		return summary;
+	}
+
+	std::vector<size_t> TransactionColumns::GetAmountHistogram(const std::vector<uint32_t>& someBounds, uint32_t aFromHeight, uint32_t aToHeight) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		const auto range = GetRange(aFromHeight, aToHeight);
+		const size_t count = range.second - range.first;
+		//One counting pass per bound, each bucket is the difference between its two neighbouring bounds
+		std::vector<size_t> buckets(someBounds.size() + 1);
+		size_t atLeastPrevious = count;
+		for (size_t i = 0; i < someBounds.size(); i++)
+		{
+			const size_t atLeast = CU::ColumnScan::CountAtLeast(mAmounts.data() + range.first, count, someBounds[i]);
+			buckets[i] = atLeastPrevious - atLeast;
+			atLeastPrevious = atLeast;
+		}
+		buckets.back() = atLeastPrevious;
+		return buckets;
+	}
+
+	std::pair<size_t, size_t> TransactionColumns::GetRange(uint32_t aFromHeight, uint32_t aToHeight) const
+	{
+		const auto first = std::lower_bound(mHeights.begin() + mFirstRow, mHeights.end(), aFromHeight);
+		const auto last = std::lower_bound(first, mHeights.end(), std::max(aFromHeight, aToHeight));
+		return { static_cast<size_t>(first - mHeights.begin()), static_cast<size_t>(last - mHeights.begin()) };
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "AddressTable.h"
+#include "Block.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace emmaChain {
+	//What an address sent and received over a range of blocks
+	struct AddressSummary
+	{
+		uint64_t mSent{};
+		uint64_t mReceived{};
+		size_t mSentCount{};
+		size_t mReceivedCount{};
+	};
+
+	//The confirmed transactions of the blocks whose bodies a node keeps, one array per field, appended as blocks are added to the chain.
+	//Aggregates scan one or two arrays with CU::ColumnScan instead of walking blocks, and are safe to run while blocks come in.
+	//Height ranges are [aFromHeight, aToHeight), the default covers every block from GetFirstHeight() on.
+	class TransactionColumns {
+	public:
+		static constexpr uint32_t END_HEIGHT = std::numeric_limits<uint32_t>::max();
+
+		//aBlock has to be above every block appended so far, its addresses interned in the table the queries use
+		void Append(const Block& aBlock);
+		//Drops the transactions of the blocks from aHeight on, for when the chain was replaced from there
+		void Truncate(uint32_t aHeight);
+		//Drops the transactions of the blocks below aHeight, for when their bodies were pruned
+		void DropBelow(uint32_t aHeight);
+		//Lowest height the columns still cover, a range that starts below it only counts the blocks from there on
+		uint32_t GetFirstHeight() const;
+
+		size_t GetCount(uint32_t aFromHeight = 0, uint32_t aToHeight = END_HEIGHT) const;
+		uint64_t GetVolume(uint32_t aFromHeight = 0, uint32_t aToHeight = END_HEIGHT) const;
+		AddressSummary GetAddressSummary(AddressId anAddress, uint32_t aFromHeight = 0, uint32_t aToHeight = END_HEIGHT) const;
+		//Transactions per amount bucket. Bucket 0 holds amounts below someBounds[0], bucket i amounts from someBounds[i - 1]
+		//up to someBounds[i] and the last one everything from someBounds.back() on. someBounds has to be ascending.
+		std::vector<size_t> GetAmountHistogram(const std::vector<uint32_t>& someBounds, uint32_t aFromHeight = 0, uint32_t aToHeight = END_HEIGHT) const;
+
+	private:
+		//Positions of the first and one past the last transaction in the height range, the caller holds mMutex
+		std::pair<size_t, size_t> GetRange(uint32_t aFromHeight, uint32_t aToHeight) const;
+
+		//Heights never go down, so a height range is a contiguous run of every column.
+		//Rows before mFirstRow were dropped, they are only erased once they make up half of the columns.
+		std::vector<uint32_t> mHeights;
+		std::vector<uint32_t> mAmounts;
+		std::vector<AddressId> mSenders;
+		std::vector<AddressId> mRecipients;
+		size_t mFirstRow{};
+		uint32_t mFirstHeight{};
+		mutable std::shared_mutex mMutex;
+	};
+}
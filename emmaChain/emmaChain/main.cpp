@@ -1,30 +1,99 @@
 #include "Blockchain.h"
+#include "MiningWorker.h"
 #include "Server.h"
 
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include <thread>
 
-int main() {
-	std::thread thread1([]() {
-		short port = 18080;
-		emmaChain::Server server(port);
-		emmaChain::Blockchain blockchain(server);
+namespace {
+	//Shared memory the node on aPort publishes its blocks to mine under
+	std::string MiningQueueName(short aPort)
+	{
+		return "emmaChain-mining-" + std::to_string(aPort);
+	}
 
-		server.Initialize(blockchain);
-		server.Run();
-		});
+	//Directory the node on aPort keeps its blocks in, relative to the working directory
+	std::string BlockStoreDirectory(short aPort)
+	{
+		return "emmaChain-blocks-" + std::to_string(aPort);
+	}
 
-	std::thread thread2([]() {
-		short port = 18081;
-		emmaChain::Server server(port);
+	void RunNode(short aPort, bool aUseMiningWorkers, size_t aKeptBodies, const std::string& anImportPath)
+	{
+		emmaChain::Server server(aPort);
 		emmaChain::Blockchain blockchain(server);
+		blockchain.SetKeptBodies(aKeptBodies);
+		if (!blockchain.OpenBlockStore(BlockStoreDirectory(aPort)))
+		{
+			std::cout << "Node " << aPort << " can't use " << BlockStoreDirectory(aPort) << " and keeps its blocks in memory only" << std::endl;
+		}
+		if (!anImportPath.empty())
+		{
+			const bool imported = blockchain.ImportChain(anImportPath);
+			std::cout << "Node " << aPort << (imported ? " imported " : " stopped importing at a bad block of ") << anImportPath
+				<< ", its chain has " << blockchain.GetNextIndex() << " blocks" << std::endl;
+		}
+		if (aUseMiningWorkers)
+		{
+			if (blockchain.UseMiningWorkers(MiningQueueName(aPort)))
+			{
+				std::cout << "Node " << aPort << " mines through workers started with --worker " << aPort << std::endl;
+			}
+			else
+			{
+				std::cout << "Node " << aPort << " can't create its mining queue and mines on local threads" << std::endl;
+			}
+		}
 
 		server.Initialize(blockchain);
 		server.Run();
+	}
+}
+
+//emmaChain                          two nodes mining on their own threads
+//emmaChain --mining-workers         two nodes that leave mining to worker processes
+//emmaChain --worker <port> [core]   a worker mining for the node on <port>, pinned to core if given
+//emmaChain --prune <blocks>         keeps the transactions of only the last <blocks> blocks in memory, can follow --mining-workers
+//emmaChain --import <file>          bootstraps both nodes from a copy of a blocks.log or a saved /chain response, combines with the above
+int main(int argc, char* argv[]) {
+	if (argc >= 3 && std::strcmp(argv[1], "--worker") == 0)
+	{
+		const short port = static_cast<short>(std::atoi(argv[2]));
+		const int core = argc >= 4 ? std::atoi(argv[3]) : -1;
+		return emmaChain::RunMiningWorker(MiningQueueName(port), core);
+	}
+	bool useMiningWorkers = false;
+	size_t keptBodies = 0;
+	std::string importPath;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--mining-workers") == 0)
+		{
+			useMiningWorkers = true;
+		}
+		else if (std::strcmp(argv[i], "--prune") == 0 && i + 1 < argc)
+		{
+			keptBodies = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--import") == 0 && i + 1 < argc)
+		{
+			importPath = argv[++i];
+		}
+	}
+
+	std::thread thread1([useMiningWorkers, keptBodies, importPath]() {
+		RunNode(18080, useMiningWorkers, keptBodies, importPath);
+		});
+
+	std::thread thread2([useMiningWorkers, keptBodies, importPath]() {
+		RunNode(18081, useMiningWorkers, keptBodies, importPath);
 		});
 
 	std::cin.get();
 
 	return 0;
-}
\ No newline at end of file
+}